@@ -0,0 +1,225 @@
+//============================================================================
+// Name        : Benchmark.cpp
+// Author      : Max Foster
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary maths microbenchmarks
+//============================================================================
+
+#ifdef COMPILE_BENCHMARK
+
+#include <iostream>
+#include <cmath>
+#include <chrono>
+using namespace std;
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Utils.h>
+#include <SuperMaximo_GameLibrary/classes/OcclusionBuffer.h>
+using namespace SuperMaximo;
+
+//Plain scalar versions of the operators, used as the reference for both results and timings.
+//Build with COMPILE_BENCHMARK defined and the same optimisation/instruction set flags as the library
+static mat4 scalarMultiply(const mat4 & a, const mat4 & b) {
+	mat4 returnMatrix;
+	for (short i = 0; i < 16; i += 4) {
+		for (short j = 0; j < 4; j++) {
+			returnMatrix.component[i+j] = (a.component[j]*b.component[i])+(a.component[4+j]*b.component[i+1])+
+					(a.component[8+j]*b.component[i+2])+(a.component[12+j]*b.component[i+3]);
+		}
+	}
+	return returnMatrix;
+}
+
+static mat3 scalarMultiply(const mat3 & a, const mat3 & b) {
+	mat3 returnMatrix;
+	for (short i = 0; i < 9; i += 3) {
+		for (short j = 0; j < 3; j++) {
+			returnMatrix.component[i+j] = (a.component[j]*b.component[i])+(a.component[3+j]*b.component[i+1])+
+					(a.component[6+j]*b.component[i+2]);
+		}
+	}
+	return returnMatrix;
+}
+
+static vec4 scalarMultiply(const vec4 & v, const mat4 & m) {
+	return vec4((v.x*m.component[0])+(v.y*m.component[4])+(v.z*m.component[8])+(v.w*m.component[12]),
+			(v.x*m.component[1])+(v.y*m.component[5])+(v.z*m.component[9])+(v.w*m.component[13]),
+			(v.x*m.component[2])+(v.y*m.component[6])+(v.z*m.component[10])+(v.w*m.component[14]),
+			(v.x*m.component[3])+(v.y*m.component[7])+(v.z*m.component[11])+(v.w*m.component[15]));
+}
+
+static bool nearlyEqual(const float * a, const float * b, unsigned count) {
+	for (unsigned i = 0; i < count; i++) {
+		if (fabs(a[i]-b[i]) > 1e-4f*(1.0f+fabs(b[i]))) return false;
+	}
+	return true;
+}
+
+//Every element of a run is compared, so a bug in one SIMD lane or shuffle cannot hide behind the others
+static bool nearlyEqual(const mat4 * a, const mat4 * b, unsigned count) {
+	for (unsigned i = 0; i < count; i++) if (!nearlyEqual(a[i], b[i], 16)) return false;
+	return true;
+}
+
+static bool nearlyEqual(const mat3 * a, const mat3 * b, unsigned count) {
+	for (unsigned i = 0; i < count; i++) if (!nearlyEqual(a[i], b[i], 9)) return false;
+	return true;
+}
+
+static bool nearlyEqual(const vec4 * a, const vec4 * b, unsigned count) {
+	for (unsigned i = 0; i < count; i++) if (!nearlyEqual(&a[i].x, &b[i].x, 4)) return false;
+	return true;
+}
+
+static bool nearlyEqual(const vec3 * a, const vec3 * b, unsigned count) {
+	for (unsigned i = 0; i < count; i++) if (!nearlyEqual(&a[i].x, &b[i].x, 3)) return false;
+	return true;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now()-start).count();
+}
+
+static void report(const string & name, double scalarTime, double libraryTime, unsigned iterations, bool correct) {
+	cout << name << ": scalar " << (scalarTime*1e9)/iterations << " ns, library " << (libraryTime*1e9)/iterations
+			<< " ns, speedup " << scalarTime/libraryTime << "x" << (correct ? "" : " (RESULTS DIFFER)") << endl;
+}
+
+int main() {
+	const unsigned count = 256, iterations = 40000;
+	static mat4 matrices[count], scalarResults[count], libraryResults[count];
+	static mat3 matrices3[count], scalarResults3[count], libraryResults3[count];
+	static vec4 vectors[count], scalarVectors[count], libraryVectors[count];
+	mat4 otherMatrix;
+	mat3 otherMatrix3;
+	for (short i = 0; i < 16; i++) otherMatrix.component[i] = float((i*7)%11)*0.125f-0.5f;
+	for (short i = 0; i < 9; i++) otherMatrix3.component[i] = float((i*5)%7)*0.25f-0.75f;
+	for (unsigned i = 0; i < count; i++) {
+		for (short j = 0; j < 16; j++) matrices[i].component[j] = float(((i+1)*(j+3))%17)*0.1f-0.8f;
+		for (short j = 0; j < 9; j++) matrices3[i].component[j] = float(((i+2)*(j+5))%13)*0.1f-0.6f;
+		vectors[i] = vec4(float(i%7), float(i%5)-2.0f, float(i%3)*0.5f, 1.0f);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) scalarResults[j] = scalarMultiply(matrices[j], otherMatrix);
+		otherMatrix[i%16] = scalarResults[i%count][i%16]*0.001f;
+	}
+	double scalarTime = secondsSince(start);
+	for (short i = 0; i < 16; i++) otherMatrix.component[i] = float((i*7)%11)*0.125f-0.5f;
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) libraryResults[j] = matrices[j]*otherMatrix;
+		otherMatrix[i%16] = libraryResults[i%count][i%16]*0.001f;
+	}
+	double libraryTime = secondsSince(start);
+	report("mat4*mat4", scalarTime, libraryTime, iterations*count, nearlyEqual(libraryResults, scalarResults,
+			count));
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) scalarResults3[j] = scalarMultiply(matrices3[j], otherMatrix3);
+		otherMatrix3[i%9] = scalarResults3[i%count][i%9]*0.001f;
+	}
+	scalarTime = secondsSince(start);
+	for (short i = 0; i < 9; i++) otherMatrix3.component[i] = float((i*5)%7)*0.25f-0.75f;
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) libraryResults3[j] = matrices3[j]*otherMatrix3;
+		otherMatrix3[i%9] = libraryResults3[i%count][i%9]*0.001f;
+	}
+	libraryTime = secondsSince(start);
+	report("mat3*mat3", scalarTime, libraryTime, iterations*count, nearlyEqual(libraryResults3, scalarResults3,
+			count));
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) scalarVectors[j] = scalarMultiply(vectors[j], matrices[i%count]);
+	}
+	scalarTime = secondsSince(start);
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; i++) {
+		for (unsigned j = 0; j < count; j++) libraryVectors[j] = vectors[j]*matrices[i%count];
+	}
+	libraryTime = secondsSince(start);
+	report("vec4*mat4", scalarTime, libraryTime, iterations*count, nearlyEqual(libraryVectors, scalarVectors,
+			count));
+
+	const unsigned pointCount = 10000, pointIterations = 1000;
+	static vec3 points[pointCount], scalarPoints[pointCount], libraryPoints[pointCount];
+	for (unsigned i = 0; i < pointCount; i++) points[i] = vec3(float(i%31), float(i%17)-8.0f, float(i%5));
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < pointIterations; i++) {
+		for (unsigned j = 0; j < pointCount; j++) scalarPoints[j] = vec4(points[j].x, points[j].y, points[j].z, 1.0f)*
+				matrices[i%count];
+	}
+	scalarTime = secondsSince(start);
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < pointIterations; i++) {
+		transformPoints(matrices[i%count], points, libraryPoints, pointCount);
+	}
+	libraryTime = secondsSince(start);
+	report("transformPoints(vec3) vs per point vec4*mat4", scalarTime, libraryTime, pointIterations*pointCount,
+			nearlyEqual(libraryPoints, scalarPoints, pointCount));
+
+	const unsigned angleCount = 10000, angleIterations = 1000;
+	static float angles[angleCount], scalarSines[angleCount], scalarCosines[angleCount], sines[angleCount],
+			cosines[angleCount];
+	for (unsigned i = 0; i < angleCount; i++) angles[i] = float(i)*0.731f-3000.0f;
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < angleIterations; i++) {
+		for (unsigned j = 0; j < angleCount; j++) {
+			float angle = degToRad(angles[j]);
+			scalarSines[j] = sin(angle);
+			scalarCosines[j] = cos(angle);
+		}
+	}
+	scalarTime = secondsSince(start);
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < angleIterations; i++) sinCos(angles, sines, cosines, angleCount);
+	libraryTime = secondsSince(start);
+	report("sinCos batch vs sin and cos", scalarTime, libraryTime, angleIterations*angleCount,
+			nearlyEqual(sines, scalarSines, angleCount) && nearlyEqual(cosines, scalarCosines, angleCount));
+
+	//A wall in front of the camera, which looks down -z, with boxes behind, beside and in front of it and one off
+	//screen. The buffer is cleared every iteration so the wall is rasterised again each time
+	const unsigned occlusionIterations = 1000;
+	OcclusionBuffer occlusionBuffer;
+	mat4 identity;
+	identity.initIdentity();
+	const boundingBox wall = {vec3(-5.0f, -5.0f, -10.0f), vec3(5.0f, 5.0f, -9.0f)};
+	const boundingBox testBoxes[4] = {{vec3(-1.0f, -1.0f, -21.0f), vec3(1.0f, 1.0f, -20.0f)},
+			{vec3(12.0f, -1.0f, -21.0f), vec3(13.0f, 1.0f, -20.0f)},
+			{vec3(-1.0f, -1.0f, -6.0f), vec3(1.0f, 1.0f, -5.0f)},
+			{vec3(100.0f, -1.0f, -21.0f), vec3(101.0f, 1.0f, -20.0f)}};
+	const bool expectedVisible[4] = {false, true, true, false};
+	bool occlusionCorrect = true;
+
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < occlusionIterations; i++) {
+		occlusionBuffer.clear(getPerspectiveMatrix(45.0f, 2.0f, 1.0f, 100.0f));
+		occlusionBuffer.drawBox(wall, identity);
+		for (short j = 0; j < 4; j++) {
+			if (occlusionBuffer.boxVisible(testBoxes[j], identity) != expectedVisible[j]) occlusionCorrect = false;
+		}
+	}
+	double occlusionTime = secondsSince(start);
+	unsigned centreX = occlusionBuffer.width()/2, centreY = occlusionBuffer.height()/2;
+	if ((occlusionBuffer.depth(centreX, centreY) >= 1.0f) || (occlusionBuffer.depth(0, 0) != 1.0f)) {
+		occlusionCorrect = false;
+	}
+	cout << "OcclusionBuffer clear, draw a box and test 4: " << (occlusionTime*1e9)/occlusionIterations << " ns"
+			<< (occlusionCorrect ? "" : " (RESULTS DIFFER)") << endl;
+
+	return 0;
+}
+
+#endif
@@ -13,10 +13,12 @@
 #include <iostream>
 #include <vector>
 #include <GL/glew.h>
+#include "Maths.h"
 
 namespace SuperMaximo {
 
 class Shader;
+class MatrixStack;
 
 enum textureUnitEnum {
 	TEXTURE0 = GL_TEXTURE0,
@@ -46,6 +48,27 @@ enum matrixEnum {
 	MATRIX_STACK_COUNT = IDENTITY_MATRIX
 };
 
+enum axisEnum {
+	X_AXIS = 0,
+	Y_AXIS,
+	Z_AXIS
+};
+
+//Frame times in milliseconds over the last FRAME_HISTORY_LENGTH frames
+const unsigned FRAME_HISTORY_LENGTH = 256;
+
+struct frameTimeStats {
+	float mean, p50, p95, p99, max;
+	unsigned count;
+};
+
+//GL work issued by the library in one frame. Binds and program switches are the ones that got past the state cache.
+//objectsCulled counts the objects drawVisibleObjects skipped
+struct renderStats {
+	unsigned drawCalls, programSwitches, textureBinds, vertexArrayBinds, bufferBinds, uniformUploads, objectsCulled;
+	unsigned long long triangles, bytesUploaded;
+};
+
 enum blendFuncEnum {
 	ZERO = GL_ZERO,
 	ONE = GL_ONE,
@@ -72,137 +95,6 @@ enum blendFuncEquEnum {
 	MAX = GL_MAX
 };
 
-struct mat2 {
-	float component[4];
-	float & operator[](short i);
-	mat2 operator*(const mat2 & otherMat);
-	operator float*();
-	void initIdentity();
-};
-
-struct mat3 {
-	float component[9];
-	float & operator[](short i);
-	mat3 operator*(const mat3 & otherMat);
-	operator float*();
-	void initIdentity();
-};
-
-struct mat4 {
-	float component[16];
-	float & operator[](short i);
-	mat4 operator*(const mat4 & otherMat);
-	operator float*();
-	void initIdentity();
-};
-
-struct vec3;
-struct vec4;
-
-struct vec2 {
-	union {
-		float x;
-		float r;
-		float s;
-	};
-	union {
-		float y;
-		float g;
-		float t;
-	};
-
-	vec2(float x = 0.0f, float y = 0.0f);
-
-	vec2 operator+(const vec2 & otherVector);
-	vec2 operator-(const vec2 & otherVector);
-	void operator+=(const vec2 & otherVector);
-	void operator-=(const vec2 & otherVector);
-	vec2 operator*(const mat2 & matrix);
-	void operator*=(const mat2 & matrix);
-	vec2 operator*(float num);
-	void operator*=(float num);
-	vec2 operator/(float num);
-	void operator/=(float num);
-	vec2 perpendicular();
-	float dotProduct(const vec2 & otherVector);
-	bool polygonCollision(unsigned vertexCount, ...);
-	bool polygonCollision(unsigned vertexCount, vec2 * vertices);
-	bool polygonCollision(unsigned vertexCount, std::vector<vec2> vertices);
-	operator vec3();
-	operator vec4();
-};
-
-struct vec3 {
-	union {
-		float x;
-		float r;
-		float s;
-	};
-	union {
-		float y;
-		float g;
-		float t;
-	};
-	union {
-		float z;
-		float b;
-		float p;
-	};
-
-	vec3(float x = 0.0f, float y = 0.0f, float z = 0.0f);
-
-	vec3 operator+(const vec3 & otherVector);
-	vec3 operator-(const vec3 & otherVector);
-	void operator+=(const vec3 & otherVector);
-	void operator-=(const vec3 & otherVector);
-	vec3 operator*(float num);
-	void operator*=(float num);
-	vec3 operator/(float num);
-	void operator/=(float num);
-	float dotProduct(const vec3 & otherVector);
-	operator vec2();
-	operator vec4();
-};
-
-struct vec4 {
-	union {
-		float x;
-		float r;
-		float s;
-	};
-	union {
-		float y;
-		float g;
-		float t;
-	};
-	union {
-		float z;
-		float b;
-		float p;
-	};
-	union {
-		float w;
-		float a;
-		float q;
-	};
-
-	vec4(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 0.0f);
-
-	vec4 operator+(const vec4 & otherVector);
-	vec4 operator-(const vec4 & otherVector);
-	void operator+=(const vec4 & otherVector);
-	void operator-=(const vec4 & otherVector);
-	vec4 operator*(const mat4 & matrix);
-	vec4 operator*(float num);
-	void operator*=(float num);
-	vec4 operator/(float num);
-	void operator/=(float num);
-	float dotProduct(const vec4 & otherVector);
-	operator vec2();
-	operator vec3();
-};
-
-
 bool initDisplay(unsigned width, unsigned height, unsigned depth, unsigned maxFramerate = 0,
 		bool fullScreen = false, const std::string & windowTitle = "My Game");
 void quitDisplay();
@@ -221,6 +113,8 @@ mat4 getPerspectiveMatrix(float angle, float aspectRatio, float front, float bac
 mat4 getOrthographicMatrix(float left, float right, float bottom, float top, float front, float back);
 
 mat2 get2dRotationMatrix(float angle);
+//Translation * X rotation * Y rotation * Z rotation * scale, built in one pass. Rotations are in degrees
+mat4 getTransformationMatrix(const vec3 & position, const vec3 & rotation, const vec3 & scale = vec3(1.0f, 1.0f, 1.0f));
 
 void bindShader(Shader * shader);
 Shader * boundShader();
@@ -228,17 +122,47 @@ Shader * boundShader();
 void bindTextureUnit(textureUnitEnum textureUnit);
 textureUnitEnum boundTextureUnit();
 
+//Cached GL state. These skip the GL call when the object is already bound, so the library and anything drawing
+//alongside it must use them (and the delete functions, which clear stale entries) rather than the GL calls. Call
+//invalidateStateCache after changing any of this state directly, or the next bind may be wrongly skipped.
+//Textures are bound to the current texture unit
+void bindProgram(GLuint program);
+GLuint boundProgram();
+void bindTexture(GLenum target, GLuint texture);
+GLuint boundTexture(GLenum target);
+void bindVertexArray(GLuint vertexArray);
+GLuint boundVertexArray();
+void bindBuffer(GLenum target, GLuint buffer);
+GLuint boundBuffer(GLenum target);
+//Also binds buffer to target itself, as glBindBufferBase does
+void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void deleteProgram(GLuint program);
+void deleteTexture(GLuint texture);
+void deleteVertexArray(GLuint vertexArray);
+void deleteBuffer(GLuint buffer);
+void invalidateStateCache();
+
+//Binds the stack used by the matrix functions below on the calling thread. NULL binds the default stack
+void bindMatrixStack(MatrixStack * matrixStack);
+MatrixStack * boundMatrixStack();
+
 void setMatrix(matrixEnum matrixId);
 matrixEnum currentMatrix();
 void copyMatrix(matrixEnum srcMatrixId, matrixEnum dstMatrixId);
 void copyMatrix(mat4 srcMatrix, matrixEnum dstMatrixId);
 mat4 getMatrix(matrixEnum matrixId);
+//The frustum of the current projection and modelview matrices, with its planes in the space of the modelview matrix
+frustum getViewFrustum();
 void pushMatrix();
 void popMatrix();
 
 void translateMatrix(float x, float y, float z);
 void rotateMatrix(float angle, float x, float y, float z);
+void rotateMatrix(float angle, axisEnum axis);
 void scaleMatrix(float xScale, float yScale, float zScale);
+//Equivalent to translateMatrix, rotateMatrix about X, Y and Z, then scaleMatrix, but with a single multiply
+void transformMatrix(const vec3 & position, const vec3 & rotation, const vec3 & scale = vec3(1.0f, 1.0f, 1.0f));
+void multiplyMatrix(const mat4 & otherMatrix);
 
 void refreshScreen();
 unsigned getFramerate();
@@ -246,11 +170,36 @@ unsigned getTickDifference();
 void setIdealFramerate(unsigned newIdealFramerate);
 unsigned getIdealFramerate();
 float compensation();
+//Length of the last frame in milliseconds, measured with a monotonic nanosecond clock
+float getFrameTime();
+frameTimeStats getFrameTimeStats();
+void clearFrameTimeStats();
+//When limiting the framerate, refreshScreen sleeps until this long before the frame is due and then spins, trading a
+//little CPU time for accuracy. The default is 1500 microseconds
+void setFrameSleepSlack(unsigned microseconds);
+unsigned frameSleepSlack();
+//Counts for the last complete frame. refreshScreen starts a new count in currentRenderStats(), which code making its
+//own GL calls can add to
+renderStats getRenderStats();
+renderStats & currentRenderStats();
+
+//Calls updateFunction updateRate times a second and drawFunction once per frame (followed by refreshScreen) until
+//updateFunction returns false. compensation() is idealFramerate/updateRate during updates, so relative movement keeps
+//its speed. After maxUpdatesPerFrame updates in one frame the simulation slows down rather than spiralling. A
+//maxUpdatesPerFrame of 0 is treated as 1
+void runGameLoop(unsigned updateRate, bool (*updateFunction)(void*), void (*drawFunction)(void*), void * data = NULL,
+		unsigned maxUpdatesPerFrame = 5);
+bool gameLoopRunning();
+//How far between the last two simulation steps the frame being drawn is, from 0 to 1. Always 1 outside the game loop
+float interpolationAlpha();
+//Number of completed updates. During an update this is the index of that update
+unsigned long long simulationTick();
 
 void enableBlending(blendFuncEnum srcBlendFunc = ONE, blendFuncEnum dstBlendFunc = ZERO,
 		blendFuncEquEnum blendFuncEquation = FUNC_ADD);
 void disableBlending();
 bool blendingEnabled();
+void getBlendFunc(blendFuncEnum * srcBlendFunc, blendFuncEnum * dstBlendFunc, blendFuncEquEnum * blendFuncEquation);
 
 void enableDepthTesting();
 void disableDepthTesting();
@@ -260,6 +209,67 @@ float openglVersion();
 float glslVersion();
 
 bool vertexArrayObjectSupported();
+bool uniformBufferObjectSupported();
+//Instanced arrays and draws, along with vertex array objects
+bool instancingSupported();
+//Packed normal and half float vertex attributes, along with uniform buffer objects
+bool compactVerticesSupported();
+//Persistently mapped buffer storage, along with fence syncs
+bool bufferStorageSupported();
+bool textureBufferSupported();
+
+//Keeps a uniform buffer bound to FRAME_UNIFORM_BLOCK holding the projection matrix and other per frame values, so
+//shaders that link the block (see Shader::setUniformBlock) skip their own projection upload on every draw. In GLSL:
+//	layout(std140) uniform FrameUniforms {
+//		mat4 projectionMatrix;
+//		vec4 screen; //Width, height, depth, compensation
+//	};
+void enableFrameUniforms();
+void disableFrameUniforms();
+bool frameUniformsEnabled();
+//Uploads the block if anything in it has changed since the last call. Called by Shader::setProjectionUniform
+void updateFrameUniforms();
+
+//Models loaded while enabled store 24 byte vertices instead of 96 byte ones, with their materials in a uniform buffer
+//bound to MATERIAL_UNIFORM_BLOCK when they are drawn. The attributes are the position as a vec3 in VERTEX_ATTRIBUTE,
+//the normal in NORMAL_ATTRIBUTE, the texture coordinates as a vec2 in TEXTURE0_ATTRIBUTE, the material index in
+//EXTRA0_ATTRIBUTE and the bone id, or -1, in EXTRA4_ATTRIBUTE. In GLSL:
+//	struct Material {
+//		vec4 ambient; //rgb, texture layer or -1 without a texture
+//		vec4 diffuse; //rgb, alpha
+//		vec4 specular; //rgb, shininess
+//	};
+//	layout(std140) uniform ModelMaterials {
+//		Material materials[256]; //MODEL_MAX_MATERIALS
+//	};
+//Models with more materials than that, or with a custom buffer function, keep the full layout
+void enableCompactVertices();
+void disableCompactVertices();
+bool compactVerticesEnabled();
+
+const textureUnitEnum BONE_TEXTURE_UNIT = TEXTURE15;
+
+//While enabled, skinned models write their bone matrices to a texture buffer, one palette per draw or instance,
+//instead of uploading them to an EXTRA0_LOCATION uniform array, so skeletons are not limited by how many uniforms a
+//shader can hold. Draws set BONESAMPLER_LOCATION to BONE_TEXTURE_UNIT and BONEOFFSET_LOCATION to the first texel of
+//their palette. Instanced draws give each instance's first texel in the fourth component of INSTANCE_DATA_ATTRIBUTE.
+//Bone matrices are modelview matrices, as in the uniform array, and take four texels each, a column at a time. In GLSL:
+//	uniform samplerBuffer bones;
+//	uniform int boneOffset;
+//	mat4 boneMatrix(int palette, int bone) {
+//		int texel = palette+(bone*4);
+//		return mat4(texelFetch(bones, texel), texelFetch(bones, texel+1), texelFetch(bones, texel+2),
+//				texelFetch(bones, texel+3));
+//	}
+//Up to maxBonesPerFrame matrices are written each frame without waiting for the GPU, within the texture buffer size.
+//Writing more flushes the render queue and can wait
+void enableBoneTextures(unsigned maxBonesPerFrame = 4096);
+void disableBoneTextures();
+bool boneTexturesEnabled();
+//Writes count matrices to the palette and returns the texel offset of the first, or -1 if bone textures are disabled
+//or there are more than maxBonesPerFrame
+long writeBonePalette(const mat4 * bones, unsigned count);
+GLuint bonePaletteTexture();
 
 void enableTexture2dArray();
 void disableTexture2dArray();
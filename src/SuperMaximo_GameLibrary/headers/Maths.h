@@ -0,0 +1,499 @@
+//============================================================================
+// Name        : Maths.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary vector and matrix types
+//============================================================================
+
+#ifndef MATHS_H_
+#define MATHS_H_
+
+#include <vector>
+#include <cmath>
+
+//The matrix kernels pick the widest instruction set enabled at compile time. Define SM_NO_SIMD to force the
+//scalar versions
+#if !defined(SM_NO_SIMD) && defined(__AVX__)
+#define SM_SIMD_AVX
+#define SM_SIMD_SSE
+#include <immintrin.h>
+#elif !defined(SM_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1)))
+#define SM_SIMD_SSE
+#include <xmmintrin.h>
+#elif !defined(SM_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace SuperMaximo {
+
+//Column major 3x3 multiply. Columns are loaded with an extra (ignored) lane where that stays inside the array
+inline void multiplyMat3(const float * a, const float * b, float * result) {
+#if defined(SM_SIMD_SSE)
+	__m128 column0 = _mm_loadu_ps(a), column1 = _mm_loadu_ps(a+3),
+		column2 = _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(a+6)), _mm_load_ss(a+8));
+	for (short i = 0; i < 3; i++) {
+		__m128 resultColumn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(b[i*3])),
+				_mm_mul_ps(column1, _mm_set1_ps(b[(i*3)+1]))), _mm_mul_ps(column2, _mm_set1_ps(b[(i*3)+2])));
+		if (i < 2) _mm_storeu_ps(result+(i*3), resultColumn); else {
+			_mm_storel_pi((__m64 *)(result+6), resultColumn);
+			_mm_store_ss(result+8, _mm_movehl_ps(resultColumn, resultColumn));
+		}
+	}
+#elif defined(SM_SIMD_NEON)
+	float column2Data[4] = {a[6], a[7], a[8], 0.0f};
+	float32x4_t column0 = vld1q_f32(a), column1 = vld1q_f32(a+3), column2 = vld1q_f32(column2Data);
+	for (short i = 0; i < 3; i++) {
+		float32x4_t resultColumn = vmulq_n_f32(column0, b[i*3]);
+		resultColumn = vmlaq_n_f32(resultColumn, column1, b[(i*3)+1]);
+		resultColumn = vmlaq_n_f32(resultColumn, column2, b[(i*3)+2]);
+		if (i < 2) vst1q_f32(result+(i*3), resultColumn); else {
+			vst1q_f32(column2Data, resultColumn);
+			result[6] = column2Data[0], result[7] = column2Data[1], result[8] = column2Data[2];
+		}
+	}
+#else
+	for (short i = 0; i < 3; i++) {
+		for (short j = 0; j < 3; j++)
+			result[(i*3)+j] = (a[j]*b[i*3])+(a[3+j]*b[(i*3)+1])+(a[6+j]*b[(i*3)+2]);
+	}
+#endif
+}
+
+//Column major 4x4 multiply, each result column being a linear combination of the columns of a
+inline void multiplyMat4(const float * a, const float * b, float * result) {
+#if defined(SM_SIMD_AVX)
+	__m256 column0 = _mm256_broadcast_ps((const __m128 *)a), column1 = _mm256_broadcast_ps((const __m128 *)(a+4)),
+		column2 = _mm256_broadcast_ps((const __m128 *)(a+8)), column3 = _mm256_broadcast_ps((const __m128 *)(a+12));
+	for (short i = 0; i < 16; i += 8) {
+		__m256 otherColumns = _mm256_loadu_ps(b+i);
+		__m256 resultColumns = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(column0, _mm256_permute_ps(otherColumns, 0x00)),
+					_mm256_mul_ps(column1, _mm256_permute_ps(otherColumns, 0x55))),
+				_mm256_add_ps(_mm256_mul_ps(column2, _mm256_permute_ps(otherColumns, 0xAA)),
+					_mm256_mul_ps(column3, _mm256_permute_ps(otherColumns, 0xFF))));
+		_mm256_storeu_ps(result+i, resultColumns);
+	}
+#elif defined(SM_SIMD_SSE)
+	__m128 column0 = _mm_loadu_ps(a), column1 = _mm_loadu_ps(a+4), column2 = _mm_loadu_ps(a+8),
+		column3 = _mm_loadu_ps(a+12);
+	for (short i = 0; i < 16; i += 4) {
+		__m128 resultColumn = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(b[i])), _mm_mul_ps(column1, _mm_set1_ps(b[i+1]))),
+				_mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(b[i+2])), _mm_mul_ps(column3, _mm_set1_ps(b[i+3]))));
+		_mm_storeu_ps(result+i, resultColumn);
+	}
+#elif defined(SM_SIMD_NEON)
+	float32x4_t column0 = vld1q_f32(a), column1 = vld1q_f32(a+4), column2 = vld1q_f32(a+8),
+		column3 = vld1q_f32(a+12);
+	for (short i = 0; i < 16; i += 4) {
+		float32x4_t resultColumn = vmulq_n_f32(column0, b[i]);
+		resultColumn = vmlaq_n_f32(resultColumn, column1, b[i+1]);
+		resultColumn = vmlaq_n_f32(resultColumn, column2, b[i+2]);
+		resultColumn = vmlaq_n_f32(resultColumn, column3, b[i+3]);
+		vst1q_f32(result+i, resultColumn);
+	}
+#else
+	for (short i = 0; i < 16; i += 4) {
+		for (short j = 0; j < 4; j++)
+			result[i+j] = (a[j]*b[i])+(a[4+j]*b[i+1])+(a[8+j]*b[i+2])+(a[12+j]*b[i+3]);
+	}
+#endif
+}
+
+//Transforms the column vector v by the column major matrix m
+inline void multiplyMat4Vec4(const float * m, const float * v, float * result) {
+#if defined(SM_SIMD_SSE)
+	__m128 resultVector = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0])), _mm_mul_ps(_mm_loadu_ps(m+4), _mm_set1_ps(v[1]))),
+			_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m+8), _mm_set1_ps(v[2])), _mm_mul_ps(_mm_loadu_ps(m+12), _mm_set1_ps(v[3]))));
+	_mm_storeu_ps(result, resultVector);
+#elif defined(SM_SIMD_NEON)
+	float32x4_t resultVector = vmulq_n_f32(vld1q_f32(m), v[0]);
+	resultVector = vmlaq_n_f32(resultVector, vld1q_f32(m+4), v[1]);
+	resultVector = vmlaq_n_f32(resultVector, vld1q_f32(m+8), v[2]);
+	resultVector = vmlaq_n_f32(resultVector, vld1q_f32(m+12), v[3]);
+	vst1q_f32(result, resultVector);
+#else
+	for (short i = 0; i < 4; i++) result[i] = (v[0]*m[i])+(v[1]*m[4+i])+(v[2]*m[8+i])+(v[3]*m[12+i]);
+#endif
+}
+
+struct mat2 {
+	float component[4];
+
+	float & operator[](short i) {
+		return component[i];
+	}
+	constexpr const float & operator[](short i) const {
+		return component[i];
+	}
+	mat2 operator*(const mat2 & otherMat) const {
+		mat2 returnMatrix;
+		returnMatrix.component[0] = (component[0]*otherMat.component[0])+(component[2]*otherMat.component[1]);
+		returnMatrix.component[1] = (component[1]*otherMat.component[0])+(component[3]*otherMat.component[1]);
+
+		returnMatrix.component[2] = (component[0]*otherMat.component[2])+(component[2]*otherMat.component[3]);
+		returnMatrix.component[3] = (component[1]*otherMat.component[2])+(component[3]*otherMat.component[3]);
+		return returnMatrix;
+	}
+	operator float*() {
+		return component;
+	}
+	operator const float*() const {
+		return component;
+	}
+	void initIdentity() {
+		component[0] = component[3] = 1.0f;
+		component[1] = component[2] = 0.0f;
+	}
+};
+
+struct mat3 {
+	float component[9];
+
+	float & operator[](short i) {
+		return component[i];
+	}
+	constexpr const float & operator[](short i) const {
+		return component[i];
+	}
+	mat3 operator*(const mat3 & otherMat) const {
+		mat3 returnMatrix;
+		multiplyMat3(component, otherMat.component, returnMatrix.component);
+		return returnMatrix;
+	}
+	operator float*() {
+		return component;
+	}
+	operator const float*() const {
+		return component;
+	}
+	void initIdentity() {
+		for (short i = 0; i < 9; i++) component[i] = 0.0f;
+		component[0] = component[4] = component[8] = 1.0f;
+	}
+};
+
+struct mat4 {
+	float component[16];
+
+	float & operator[](short i) {
+		return component[i];
+	}
+	constexpr const float & operator[](short i) const {
+		return component[i];
+	}
+	mat4 operator*(const mat4 & otherMat) const {
+		mat4 returnMatrix;
+		multiplyMat4(component, otherMat.component, returnMatrix.component);
+		return returnMatrix;
+	}
+	operator float*() {
+		return component;
+	}
+	operator const float*() const {
+		return component;
+	}
+	void initIdentity() {
+		for (short i = 0; i < 16; i++) component[i] = 0.0f;
+		component[0] = component[5] = component[10] = component[15] = 1.0f;
+	}
+};
+
+struct vec3;
+struct vec4;
+
+struct vec2 {
+	union {
+		float x;
+		float r;
+		float s;
+	};
+	union {
+		float y;
+		float g;
+		float t;
+	};
+
+	constexpr vec2(float x = 0.0f, float y = 0.0f) : x(x), y(y) {}
+
+	constexpr vec2 operator+(const vec2 & otherVector) const {
+		return vec2(x+otherVector.x, y+otherVector.y);
+	}
+	constexpr vec2 operator-(const vec2 & otherVector) const {
+		return vec2(x-otherVector.x, y-otherVector.y);
+	}
+	void operator+=(const vec2 & otherVector) {
+		x += otherVector.x, y += otherVector.y;
+	}
+	void operator-=(const vec2 & otherVector) {
+		x -= otherVector.x, y -= otherVector.y;
+	}
+	constexpr vec2 operator*(const mat2 & matrix) const {
+		return vec2((x*matrix.component[0])+(y*matrix.component[2]), (x*matrix.component[1])+(y*matrix.component[3]));
+	}
+	void operator*=(const mat2 & matrix) {
+		*this = (*this)*matrix;
+	}
+	constexpr vec2 operator*(float num) const {
+		return vec2(x*num, y*num);
+	}
+	void operator*=(float num) {
+		x *= num, y *= num;
+	}
+	constexpr vec2 operator/(float num) const {
+		return vec2(x/num, y/num);
+	}
+	void operator/=(float num) {
+		x /= num, y /= num;
+	}
+	constexpr vec2 perpendicular() const {
+		return vec2(-y, x);
+	}
+	constexpr float dotProduct(const vec2 & otherVector) const {
+		return (x*otherVector.x)+(y*otherVector.y);
+	}
+	bool polygonCollision(unsigned vertexCount, ...) const;
+	bool polygonCollision(unsigned vertexCount, const vec2 * vertices) const;
+	bool polygonCollision(unsigned vertexCount, const std::vector<vec2> & vertices) const;
+	constexpr operator vec3() const;
+	constexpr operator vec4() const;
+};
+
+struct vec3 {
+	union {
+		float x;
+		float r;
+		float s;
+	};
+	union {
+		float y;
+		float g;
+		float t;
+	};
+	union {
+		float z;
+		float b;
+		float p;
+	};
+
+	constexpr vec3(float x = 0.0f, float y = 0.0f, float z = 0.0f) : x(x), y(y), z(z) {}
+
+	constexpr vec3 operator+(const vec3 & otherVector) const {
+		return vec3(x+otherVector.x, y+otherVector.y, z+otherVector.z);
+	}
+	constexpr vec3 operator-(const vec3 & otherVector) const {
+		return vec3(x-otherVector.x, y-otherVector.y, z-otherVector.z);
+	}
+	void operator+=(const vec3 & otherVector) {
+		x += otherVector.x, y += otherVector.y, z += otherVector.z;
+	}
+	void operator-=(const vec3 & otherVector) {
+		x -= otherVector.x, y -= otherVector.y, z -= otherVector.z;
+	}
+	constexpr vec3 operator*(float num) const {
+		return vec3(x*num, y*num, z*num);
+	}
+	void operator*=(float num) {
+		x *= num, y *= num, z *= num;
+	}
+	constexpr vec3 operator/(float num) const {
+		return vec3(x/num, y/num, z/num);
+	}
+	void operator/=(float num) {
+		x /= num, y /= num, z /= num;
+	}
+	constexpr float dotProduct(const vec3 & otherVector) const {
+		return (x*otherVector.x)+(y*otherVector.y)+(z*otherVector.z);
+	}
+	constexpr operator vec2() const {
+		return vec2(x, y);
+	}
+	constexpr operator vec4() const;
+};
+
+struct vec4 {
+	union {
+		float x;
+		float r;
+		float s;
+	};
+	union {
+		float y;
+		float g;
+		float t;
+	};
+	union {
+		float z;
+		float b;
+		float p;
+	};
+	union {
+		float w;
+		float a;
+		float q;
+	};
+
+	constexpr vec4(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 0.0f) : x(x), y(y), z(z), w(w) {}
+
+	constexpr vec4 operator+(const vec4 & otherVector) const {
+		return vec4(x+otherVector.x, y+otherVector.y, z+otherVector.z, w+otherVector.w);
+	}
+	constexpr vec4 operator-(const vec4 & otherVector) const {
+		return vec4(x-otherVector.x, y-otherVector.y, z-otherVector.z, w-otherVector.w);
+	}
+	void operator+=(const vec4 & otherVector) {
+		x += otherVector.x, y += otherVector.y, z += otherVector.z, w += otherVector.w;
+	}
+	void operator-=(const vec4 & otherVector) {
+		x -= otherVector.x, y -= otherVector.y, z -= otherVector.z, w -= otherVector.w;
+	}
+	vec4 operator*(const mat4 & matrix) const {
+		vec4 returnVector;
+		multiplyMat4Vec4(matrix.component, &x, &returnVector.x);
+		return returnVector;
+	}
+	constexpr vec4 operator*(float num) const {
+		return vec4(x*num, y*num, z*num, w*num);
+	}
+	void operator*=(float num) {
+		x *= num, y *= num, z *= num, w *= num;
+	}
+	constexpr vec4 operator/(float num) const {
+		return vec4(x/num, y/num, z/num, w/num);
+	}
+	void operator/=(float num) {
+		x /= num, y /= num, z /= num, w /= num;
+	}
+	constexpr float dotProduct(const vec4 & otherVector) const {
+		return (x*otherVector.x)+(y*otherVector.y)+(z*otherVector.z)+(w*otherVector.w);
+	}
+	constexpr operator vec2() const {
+		return vec2(x, y);
+	}
+	constexpr operator vec3() const {
+		return vec3(x, y, z);
+	}
+};
+
+constexpr vec2::operator vec3() const {
+	return vec3(x, y, 0.0f);
+}
+
+constexpr vec2::operator vec4() const {
+	return vec4(x, y, 0.0f, 0.0f);
+}
+
+constexpr vec3::operator vec4() const {
+	return vec4(x, y, z, 0.0f);
+}
+
+//Rotation quaternion. Multiplying two quaternions gives the rotation of the right hand one followed by the left
+struct quat {
+	float x, y, z, w;
+
+	constexpr quat(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 1.0f) : x(x), y(y), z(z), w(w) {}
+
+	constexpr quat operator*(const quat & otherQuat) const {
+		return quat((w*otherQuat.x)+(x*otherQuat.w)+(y*otherQuat.z)-(z*otherQuat.y),
+				(w*otherQuat.y)-(x*otherQuat.z)+(y*otherQuat.w)+(z*otherQuat.x),
+				(w*otherQuat.z)+(x*otherQuat.y)-(y*otherQuat.x)+(z*otherQuat.w),
+				(w*otherQuat.w)-(x*otherQuat.x)-(y*otherQuat.y)-(z*otherQuat.z));
+	}
+	constexpr quat operator*(float num) const {
+		return quat(x*num, y*num, z*num, w*num);
+	}
+	constexpr quat operator+(const quat & otherQuat) const {
+		return quat(x+otherQuat.x, y+otherQuat.y, z+otherQuat.z, w+otherQuat.w);
+	}
+	constexpr quat conjugate() const {
+		return quat(-x, -y, -z, w);
+	}
+	constexpr float dotProduct(const quat & otherQuat) const {
+		return (x*otherQuat.x)+(y*otherQuat.y)+(z*otherQuat.z)+(w*otherQuat.w);
+	}
+	quat normalised() const {
+		return (*this)*(1.0f/std::sqrt(dotProduct(*this)));
+	}
+	//Column major rotation matrix. The quaternion is assumed to be normalised
+	operator mat4() const {
+		mat4 returnMatrix;
+		float x2 = x+x, y2 = y+y, z2 = z+z;
+		returnMatrix.component[0] = 1.0f-(y*y2)-(z*z2);
+		returnMatrix.component[1] = (x*y2)+(w*z2);
+		returnMatrix.component[2] = (x*z2)-(w*y2);
+		returnMatrix.component[3] = 0.0f;
+
+		returnMatrix.component[4] = (x*y2)-(w*z2);
+		returnMatrix.component[5] = 1.0f-(x*x2)-(z*z2);
+		returnMatrix.component[6] = (y*z2)+(w*x2);
+		returnMatrix.component[7] = 0.0f;
+
+		returnMatrix.component[8] = (x*z2)+(w*y2);
+		returnMatrix.component[9] = (y*z2)-(w*x2);
+		returnMatrix.component[10] = 1.0f-(x*x2)-(y*y2);
+		returnMatrix.component[11] = 0.0f;
+
+		returnMatrix.component[12] = returnMatrix.component[13] = returnMatrix.component[14] = 0.0f;
+		returnMatrix.component[15] = 1.0f;
+		return returnMatrix;
+	}
+};
+
+//Normalised linear interpolation, taking the shorter way round
+inline quat nlerp(const quat & a, const quat & b, float t) {
+	float bScale = a.dotProduct(b) < 0.0f ? -t : t;
+	return ((a*(1.0f-t))+(b*bScale)).normalised();
+}
+
+struct boundingBox {
+	vec3 minimum, maximum;
+};
+
+struct boundingSphere {
+	vec3 centre;
+	float radius;
+};
+
+//The six planes bounding what a matrix maps inside the clip volume, each a normalised (a, b, c, d) with
+//ax+by+cz+d >= 0 on the inside. Built from projection*modelview, the planes are in model space
+struct frustum {
+	vec4 planes[6];
+
+	frustum() {}
+	explicit frustum(const mat4 & matrix);
+	//Conservative: shapes near a corner of the frustum may pass without being inside it
+	bool intersectsSphere(const vec3 & centre, float radius) const;
+	bool intersectsBox(const boundingBox & box) const;
+};
+
+//Tests count spheres, given as one array per component, against the frustum four at a time. Sets visible[i] to 1 or 0
+//and returns how many are visible
+unsigned cullSpheres(const frustum & viewFrustum, const float * x, const float * y, const float * z,
+		const float * radius, unsigned char * visible, unsigned count);
+
+//Transform count contiguous points by one matrix. The result arrays may be the same as the input arrays. vec3 points
+//are treated as positions (w = 1) with no perspective divide
+void transformPoints(const mat4 & matrix, const vec4 * points, vec4 * result, unsigned count);
+void transformPoints(const mat4 & matrix, const vec3 * points, vec3 * result, unsigned count);
+void transformPoints(const mat2 & matrix, const vec2 * points, vec2 * result, unsigned count);
+//Structure of arrays versions of the above, taking one array per component
+void transformPoints(const mat4 & matrix, const float * x, const float * y, const float * z, float * xResult,
+		float * yResult, float * zResult, unsigned count);
+void transformPoints(const mat2 & matrix, const float * x, const float * y, float * xResult, float * yResult,
+		unsigned count);
+
+//X, then Y, then Z rotation in degrees, matching getTransformationMatrix
+quat getRotationQuat(float xRot, float yRot, float zRot);
+quat slerp(const quat & a, const quat & b, float t);
+//Interpolate count pairs of quaternions at once, each with its own t. The batched slerp corrects t for the angle
+//between the pair and then uses nlerp, which stays within 1e-3 radians of an exact slerp
+void nlerp(const quat * a, const quat * b, const float * t, quat * result, unsigned count);
+void slerp(const quat * a, const quat * b, const float * t, quat * result, unsigned count);
+
+}
+
+#endif /* MATHS_H_ */
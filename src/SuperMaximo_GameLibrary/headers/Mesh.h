@@ -0,0 +1,58 @@
+//============================================================================
+// Name        : Mesh.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary triangle mesh indexing and optimisation
+//============================================================================
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace SuperMaximo {
+
+//Vertices are arrays of stride floats, starting with an x, y, z position. Indices describe triangles
+
+//Merges vertices whose floats are all identical. Writes the unique vertices, in order of first use, and an index for
+//each input vertex. Returns the number of unique vertices
+unsigned indexVertices(const float * vertices, unsigned vertexCount, unsigned stride,
+		std::vector<float> * uniqueVertices, std::vector<unsigned> * indices);
+
+//Reorders triangles so vertices are reused while they are still in the post-transform cache, using Tom Forsyth's
+//linear-speed vertex cache optimisation. It does not depend on the exact cache size of the hardware
+void optimiseVertexCache(unsigned * indices, unsigned indexCount, unsigned vertexCount);
+
+//Splits the cache optimised triangle order into runs and puts the runs facing outward from the centre of the mesh
+//first, so they tend to be drawn before what they hide. Runs are only split where the cache misses anyway, so the
+//cache efficiency barely changes
+void optimiseOverdraw(unsigned * indices, unsigned indexCount, const float * vertices, unsigned vertexCount,
+		unsigned stride);
+
+//Renumbers vertices in the order the indices first use them, so vertex fetches walk through memory
+void optimiseVertexFetch(unsigned * indices, unsigned indexCount, float * vertices, unsigned vertexCount,
+		unsigned stride);
+
+//Average number of vertices transformed per triangle for a FIFO cache of the given size. 3 is the worst, with no
+//reuse, and 0.5 is the best possible for large regular meshes
+float averageCacheMissRatio(const unsigned * indices, unsigned indexCount, unsigned vertexCount,
+		unsigned cacheSize = 16);
+
+//Collapses edges in order of least quadric error until at most targetIndexCount indices are left, or nothing more can
+//be collapsed without moving a border or seam or flipping a triangle. Vertices only move onto other vertices, so the
+//result indexes the same vertices. result needs room for indexCount indices. resultError, if given, is set to roughly
+//the furthest the surface moved. Returns the number of indices in result
+unsigned simplifyMesh(const unsigned * indices, unsigned indexCount, const float * vertices, unsigned vertexCount,
+		unsigned stride, unsigned targetIndexCount, unsigned * result, float * resultError = NULL);
+
+//Packs a unit vector for a GL_INT_2_10_10_10_REV attribute read as normalised, with w as 0
+unsigned packNormal(float x, float y, float z);
+//Converts to a 16 bit float for GL_HALF_FLOAT attributes, rounding to nearest. Values too large become infinity
+unsigned short packHalf(float value);
+
+}
+
+#endif /* MESH_H_ */
@@ -0,0 +1,83 @@
+//============================================================================
+// Name        : Profiler.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary CPU and GPU frame profiler
+//============================================================================
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <iostream>
+#include <vector>
+
+namespace SuperMaximo {
+
+//Number of frames kept by the profiler. refreshScreen ends each frame
+const unsigned PROFILE_FRAME_HISTORY_LENGTH = 120;
+
+//Times are in nanoseconds since the profiler was enabled. gpuDuration is -1 until the timer query for the scope has
+//been read back, which happens a few frames later, and stays -1 for scopes that were not GPU timed
+struct profileEvent {
+	const char * name;
+	unsigned long long start, duration;
+	long long gpuDuration;
+	unsigned short depth, thread;
+};
+
+struct profileFrame {
+	unsigned long long number, start, duration;
+	std::vector<profileEvent> events;
+};
+
+//Times the enclosing scope on the CPU and, when gpu is true and timer queries are supported, on the GPU with a
+//GL_TIME_ELAPSED query. GPU scopes do not nest, so a GPU scope inside another is only timed on the CPU. Each GPU scope
+//costs a query, and a draw in the render queue has not reached GL yet, so keep them to coarse points such as queue
+//and batch flushes. Only use gpu on the thread that owns the GL context. name must outlive the profiler, so use
+//string literals
+class ProfileScope {
+	const char * name;
+	unsigned long long start;
+	unsigned query;
+	bool active;
+
+	ProfileScope(const ProfileScope &);
+	ProfileScope & operator=(const ProfileScope &);
+
+public:
+	ProfileScope(const char * name, bool gpu = false);
+	~ProfileScope();
+};
+
+#ifdef SM_NO_PROFILER
+#define SM_PROFILE_SCOPE(name)
+#define SM_PROFILE_GPU_SCOPE(name)
+#else
+#define SM_PROFILE_CONCAT_(a, b) a##b
+#define SM_PROFILE_CONCAT(a, b) SM_PROFILE_CONCAT_(a, b)
+#define SM_PROFILE_SCOPE(name) SuperMaximo::ProfileScope SM_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define SM_PROFILE_GPU_SCOPE(name) SuperMaximo::ProfileScope SM_PROFILE_CONCAT(profileScope_, __LINE__)(name, true)
+#endif
+
+//Scopes cost a single check while the profiler is disabled
+void enableProfiler();
+void disableProfiler();
+bool profilerEnabled();
+bool gpuProfilingSupported();
+
+//Closes the current frame and collects any finished GPU timings without waiting for the GPU. Called by refreshScreen
+void endProfilerFrame();
+//0 is the last completed frame. Returns NULL if that frame is no longer (or not yet) recorded
+const profileFrame * getProfileFrame(unsigned framesAgo = 0);
+unsigned profileFrameCount();
+void clearProfiler();
+
+//Writes every recorded frame in the Chrome trace event format, which chrome://tracing and Perfetto can open. GPU
+//timings go on their own track, starting where the CPU issued them
+bool writeProfileTrace(const std::string & fileName);
+
+}
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,62 @@
+//============================================================================
+// Name        : RenderQueue.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary deferred, sorted draw submission
+//============================================================================
+
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include "Display.h"
+
+namespace SuperMaximo {
+
+class Shader;
+
+//One recorded draw of vertexCount triangle vertices from firstVertex. The constructor captures the current modelview
+//and projection matrices and the blending and depth testing state. With vertexArray 0 the vertices are read as vec4
+//positions from buffer, along with vec2 texture coordinates from texCoordOffset in buffer if that is not 0. A non zero
+//indexType draws vertexCount indices from firstVertex in the element buffer held by vertexArray instead. A non zero
+//materialBuffer is bound to MATERIAL_UNIFORM_BLOCK. A bonePaletteOffset other than -1 is passed to
+//Shader::setBonePaletteUniforms. ownedTexture and ownedBuffer are deleted once the command has been drawn
+struct renderCommand {
+	mat4 modelview, projection;
+	Shader * shader;
+	GLenum textureTarget;
+	GLuint texture, vertexArray, buffer, materialBuffer, ownedTexture, ownedBuffer;
+	GLenum indexType;
+	GLintptr texCoordOffset;
+	unsigned firstVertex, vertexCount, boneOffset, boneCount;
+	int textureCount, bonePaletteOffset;
+	bool blending, depthTesting;
+	blendFuncEnum srcBlendFunc, dstBlendFunc;
+	blendFuncEquEnum blendFuncEquation;
+
+	renderCommand(Shader * shader, GLenum textureTarget, GLuint texture, GLuint vertexArray, GLuint buffer,
+			unsigned vertexCount);
+};
+
+//While enabled, Sprite::draw, Model::draw and Font::write record commands instead of drawing. refreshScreen sorts
+//them and draws them just before the swap: by layer, then opaque before blended, then opaque commands by shader,
+//texture and vertex array (front to back within those) and blended commands back to front. Commands with equal keys
+//keep the order they were recorded in. Models need vertex array objects to be queued and are drawn immediately
+//without them
+void enableRenderQueue();
+void disableRenderQueue();
+bool renderQueueEnabled();
+
+//Layers are drawn in increasing order, whatever their depth. The default is 0
+void setRenderLayer(unsigned char layer);
+unsigned char renderLayer();
+
+//bones, if given, are uploaded to EXTRA0_LOCATION when the command is drawn
+void queueRenderCommand(const renderCommand & command, const mat4 * bones = NULL, unsigned boneCount = 0);
+void flushRenderQueue();
+unsigned renderQueueSize();
+
+}
+
+#endif /* RENDERQUEUE_H_ */
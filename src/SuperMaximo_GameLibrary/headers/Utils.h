@@ -53,6 +53,25 @@ type radToDeg(type angle) {
 	return (angle*type(180.0))/pi;
 }
 
+//Sine and cosine of an angle in degrees. The angle is reduced to within 45 degrees of a multiple of 90 and
+//polynomials are used from there, so multiples of 90 give exact results. The maximum absolute error is below 2e-7
+//for angles within +/-100000 degrees
+inline void sinCos(float angle, float * sine, float * cosine) {
+	float quadrant = floorf((angle*(1.0f/90.0f))+0.5f);
+	float x = (angle-(quadrant*90.0f))*float(pi/180.0), x2 = x*x;
+	float s = x*(1.0f+(x2*(-1.0f/6.0f+(x2*(1.0f/120.0f+(x2*(-1.0f/5040.0f+(x2*(1.0f/362880.0f)))))))));
+	float c = 1.0f+(x2*(-0.5f+(x2*(1.0f/24.0f+(x2*(-1.0f/720.0f+(x2*(1.0f/40320.0f))))))));
+	switch (int(quadrant) & 3) {
+	case 0: *sine = s, *cosine = c; break;
+	case 1: *sine = c, *cosine = -s; break;
+	case 2: *sine = -s, *cosine = -c; break;
+	default: *sine = -c, *cosine = s; break;
+	}
+}
+
+//As above for count angles at once, using SIMD where available. sines and cosines may not overlap angles
+void sinCos(const float * angles, float * sines, float * cosines, unsigned count);
+
 }
 
 #endif /* UTILS_H_ */
@@ -42,6 +42,10 @@ void bindFontShader(Shader * newFontShader);
 
 void clearFontCache();
 
+//Writes the last frame's render statistics and frame time percentiles as a few lines of text, top left at x, y. The
+//text is not cached since it changes every frame
+void writeRenderStats(Font * font, int x, int y, float depth = 0.0f);
+
 }
 
 #endif /* FONT_H_ */
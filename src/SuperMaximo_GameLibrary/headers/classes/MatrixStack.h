@@ -0,0 +1,56 @@
+//============================================================================
+// Name        : MatrixStack.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary MatrixStack class
+//============================================================================
+
+#ifndef MATRIXSTACK_H_
+#define MATRIXSTACK_H_
+
+#include "../Display.h"
+
+namespace SuperMaximo {
+
+//Current matrices plus a stack for each, all in one cache line aligned block allocated by the constructor. Pushing
+//past the capacity doubles it, which moves the block, so call reserve up front for deep bone hierarchies. The matrix
+//functions in Display.h work on the stack bound to the calling thread (see bindMatrixStack)
+class MatrixStack {
+	char * memory;
+	mat4 * matrix_, * stack_;
+	unsigned capacity_, depth_[MATRIX_STACK_COUNT];
+	matrixEnum currentMatrixId;
+
+	MatrixStack(const MatrixStack &);
+	MatrixStack & operator=(const MatrixStack &);
+
+public:
+	MatrixStack(unsigned capacity = 32);
+	~MatrixStack();
+
+	void setCurrent(matrixEnum matrixId);
+	matrixEnum current() const;
+	void copy(matrixEnum srcMatrixId, matrixEnum dstMatrixId);
+	void copy(const mat4 & srcMatrix, matrixEnum dstMatrixId);
+	//The reference is only valid until the next push
+	const mat4 & get(matrixEnum matrixId) const;
+	void push();
+	void pop();
+	unsigned depth(matrixEnum matrixId) const;
+	unsigned capacity() const;
+	//Grows every stack to hold at least capacity matrices
+	void reserve(unsigned capacity);
+
+	void translate(float x, float y, float z);
+	void rotate(float angle, float x, float y, float z);
+	void rotate(float angle, axisEnum axis);
+	void scale(float xScale, float yScale, float zScale);
+	void transform(const vec3 & position, const vec3 & rotation, const vec3 & scale = vec3(1.0f, 1.0f, 1.0f));
+	void multiply(const mat4 & otherMatrix);
+};
+
+}
+
+#endif /* MATRIXSTACK_H_ */
@@ -37,10 +37,18 @@ enum bufferUsageEnum {
 	DYNAMIC_COPY = GL_DYNAMIC_COPY
 };
 
+//The most materials a model with compact vertices can have in its uniform buffer (see enableCompactVertices)
+const unsigned MODEL_MAX_MATERIALS = 256;
+//Models with at least MODEL_LOD_MIN_TRIANGLES triangles get up to MODEL_MAX_LODS levels of detail, including the full
+//model, each with about half the triangles of the one before
+const unsigned MODEL_MAX_LODS = 4, MODEL_LOD_MIN_TRIANGLES = 256;
+
 class Model {
 	struct vertex {
 		float x, y, z;
 		vec3 normal_;
+		//Zeroed, as texture coordinates are left unset for untextured faces and would stop vertices being merged
+		vertex() : x(0.0f), y(0.0f), z(0.0f) {}
 		vertex operator- (vertex const & other);
 	};
 	struct material {
@@ -55,14 +63,28 @@ class Model {
 
 		vec3 surfaceNormal();
 	};
+	//A range of the index buffer. error is roughly how far the simplified surface is from the full one
+	struct lodLevel {
+		unsigned firstIndex, indexCount;
+		float error;
+	};
 
 	std::string name_;
 	std::vector<triangle> triangles_;
 	std::vector<material> materials_;
 	std::vector<bone *> bones_;
-	GLuint vao, vbo, texture;
+	std::vector<lodLevel> lods_;
+	//Positions and indices of the full level of detail, for drawing into occlusion buffers
+	std::vector<GLfloat> occluderVertices_;
+	std::vector<unsigned> occluderIndices_;
+	GLuint vao, vbo, ibo, texture, instanceVbo, materialUbo;
+	GLenum indexType;
+	boundingBox bounds_;
+	boundingSphere sphereBounds_;
 	Shader * boundShader_;
-	unsigned framerate_, vertexCount_, textureCount;
+	unsigned framerate_, vertexCount_, textureCount, instanceCapacity;
+	std::vector<quat> previousRotations_, nextRotations_;
+	std::vector<float> rotationSteps_;
 
 	void loadObj(const std::string & path, const std::string & fileName, bufferUsageEnum bufferUsage = STATIC_DRAW,
 			void (*customBufferFunction)(GLuint*, Model*, void*) = NULL, void * customData = NULL);
@@ -71,13 +93,22 @@ class Model {
 	void loadSma(const std::string & fileName);
 	void loadSmo(const std::string & path, const std::string & fileName, bufferUsageEnum bufferUsage = STATIC_DRAW);
 
+	void calculateBounds(const GLfloat * vertices, unsigned vertexCount, unsigned stride);
 	void initBufferObj(bufferUsageEnum bufferUsage);
+	void uploadVertexArray(GLfloat * vertexArray, bufferUsageEnum bufferUsage);
+	bool uploadCompactVertices(const std::vector<GLfloat> & vertices, bufferUsageEnum bufferUsage);
 
 	void getBoneModelviewMatrices(mat4 * matrixArray, bone * pBone);
-	void setBoneRotationsFromAnimation(unsigned animationId, float frame, bone * pBone);
+	//animationIds and frames are read every stride elements for each bone, so a stride of 0 uses one for all
+	void setBoneRotationsFromAnimation(const unsigned * animationIds, const float * frames, unsigned stride);
+	//Picks a level of detail for the current matrices, only moving to a simpler one well before it is needed so
+	//objects near the threshold do not flicker between levels
+	unsigned selectLod(unsigned currentLevel);
+	void submitDraw(Shader * shaderToUse, mat4 * boneMatrices, unsigned boneCount, unsigned lod = 0);
 
 public:
 	friend class Object;
+	friend class OcclusionBuffer;
 	friend struct keyFrame;
 	friend struct bone;
 	Model(const std::string & newName, const std::string & path, const std::string & fileName, unsigned framerate = 60,
@@ -89,6 +120,15 @@ public:
 	void draw(float x, float y, float z, float xRotation = 0.0f, float yRotation = 0.0f, float zRotation = 0.0f,
 			float xScale = 1.0f, float yScale = 1.0f, float zScale = 1.0f, float frame = 1.0f,
 			int currentAnimationId = 0, bool skipAnimation = false);
+	//Draws every object with one instanced draw call, using the model's bound shader or the globally bound shader.
+	//Each instance gets its object's transformation matrix in INSTANCE_MATRIX_ATTRIBUTE, which the shader applies
+	//before the modelview matrix, its alpha, frame and animation in the first three components of
+	//INSTANCE_DATA_ATTRIBUTE and the first texel of its bone palette in the fourth. Skinned objects each get their
+	//own palette when bone textures are enabled (see enableBoneTextures in Display.h). Without instancing, or with
+	//skeletal animation but no bone textures, the objects are drawn one at a time with draw(Object &) instead.
+	//Instanced draws are never queued
+	void drawInstanced(Object * const * objects, unsigned count, bool skipAnimation = false);
+	void drawInstanced(const std::vector<Object *> & objects, bool skipAnimation = false);
 
 	void bindShader(Shader * shader);
 	Shader * boundShader();
@@ -107,18 +147,33 @@ public:
 	GLuint * vboPointer();
 
 	unsigned vertexCount();
+
+	//Found from the vertices when the model is loaded, in the model's own space. Skeletal animation can move vertices
+	//outside them
+	boundingBox bounds();
+	boundingSphere sphereBounds();
+
+	unsigned lodCount();
+	unsigned lodTriangleCount(unsigned level);
 };
 
+//Draws use the simplest level of detail whose error would cover no more than this many pixels on screen. Instanced
+//draws always use the full model. 0 turns levels of detail off. The default is 1
+void setModelLodThreshold(float pixels);
+float modelLodThreshold();
+
 struct bone {
 	int id;
 	std::string name;
-	float x, y, z, endX, endY, endZ, xRot, yRot, zRot;
+	float x, y, z, endX, endY, endZ;
+	quat rotation;
 	bone * parent;
 	vec3 rotationUpperLimit, rotationLowerLimit;
 	std::vector<bone *> child;
 
 	struct keyFrame {
 		float xRot, yRot, zRot;
+		quat rotation;
 		unsigned step;
 	};
 
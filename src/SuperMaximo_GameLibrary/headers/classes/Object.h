@@ -17,6 +17,7 @@ namespace SuperMaximo {
 
 class Sprite;
 class Model;
+class OcclusionBuffer;
 struct bone;
 class Shader;
 
@@ -29,15 +30,27 @@ class Object {
 	float x_, y_, z_, xRotation_, yRotation_, zRotation_, xScale_, yScale_, zScale_, width_, height_, alpha_,
 		xRotatedWidth_, yRotatedWidth_, zRotatedWidth_, xRotatedHeight_, yRotatedHeight_, zRotatedHeight_, originX,
 		originY;
+	//State at the start of the last simulation tick that changed it, for drawing between ticks in runGameLoop
+	float previousX_, previousY_, previousZ_, previousXRotation_, previousYRotation_, previousZRotation_,
+		previousXScale_, previousYScale_, previousZScale_, previousAlpha_;
+	unsigned long long snapshotTick_;
+	//Level of detail of the model when it was last drawn
+	unsigned lodLevel_;
 	std::vector<unsigned> currentAnimationId;
 	std::vector<float> frame_;
 	std::string name_;
 	Shader * boundShader_;
 	customDrawFunctionType customDrawFunction;
 
+	void initSnapshot();
+	void snapshot();
+	void getInterpolatedState(vec3 * position, vec3 * rotation, vec3 * scale, float * alpha);
+
 public:
 	friend class Sprite;
+	friend class SpriteBatch;
 	friend class Model;
+	friend class OcclusionBuffer;
 
 	Object(const std::string & newName, float destX, float destY, float destZ, Sprite * newSprite = NULL);
 	Object(const std::string & newName, float destX, float destY, float destZ, Model * newModel = NULL);
@@ -98,6 +111,9 @@ public:
 	float frame(int boneId = -1);
 
 	void draw(bool skipAnimation = false);
+	//Bounding sphere of the model or sprite as it will be drawn, in the space the object is positioned in. Returns
+	//false, leaving sphere alone, if there is nothing to draw
+	bool getBoundingSphere(boundingSphere * sphere);
 
 	bool roughMouseOverBox();
 	bool mouseOverBox();
@@ -107,6 +123,20 @@ public:
 	bool circleCollision(Object * other);
 };
 
+//Appends the objects whose bounding spheres are at least partly inside viewFrustum to visible, in their original
+//order, testing the spheres four at a time. Objects with nothing to draw are kept. Returns how many were appended
+unsigned cullObjects(Object * const * objects, unsigned count, const frustum & viewFrustum,
+		std::vector<Object *> * visible);
+unsigned cullObjects(const std::vector<Object *> & objects, const frustum & viewFrustum,
+		std::vector<Object *> * visible);
+//Culls against the frustum of the current projection and modelview matrices, then against occlusionBuffer if one is
+//given, and draws the objects left, counting the rest in objectsCulled of currentRenderStats(). The occluders should
+//already be drawn into occlusionBuffer. Returns how many were drawn
+unsigned drawVisibleObjects(Object * const * objects, unsigned count, bool skipAnimation = false,
+		OcclusionBuffer * occlusionBuffer = NULL);
+unsigned drawVisibleObjects(const std::vector<Object *> & objects, bool skipAnimation = false,
+		OcclusionBuffer * occlusionBuffer = NULL);
+
 }
 
 #endif /* OBJECT_H_ */
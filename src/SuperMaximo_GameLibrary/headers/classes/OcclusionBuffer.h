@@ -0,0 +1,77 @@
+//============================================================================
+// Name        : OcclusionBuffer.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary OcclusionBuffer class for software occlusion culling
+//============================================================================
+
+#ifndef OCCLUSIONBUFFER_H_
+#define OCCLUSIONBUFFER_H_
+
+#include <vector>
+#include "../Maths.h"
+
+namespace SuperMaximo {
+
+class Object;
+
+const unsigned OCCLUSION_TILE_WIDTH = 32, OCCLUSION_TILE_HEIGHT = 8;
+
+//A low resolution depth buffer that occluders are drawn into on the CPU, so that objects hidden behind them can be
+//skipped before they are drawn. Triangles are sorted into tiles as they are drawn and each tile is rasterised in one
+//go, four pixels at a time, the first time the buffer is tested. Nothing here uses GL or the matrix stacks, so a
+//frame's occluders can be drawn and tested on a worker thread. Triangles crossing the near plane are skipped and
+//boxes crossing it are always visible, so mistakes only ever let hidden objects through
+class OcclusionBuffer {
+	struct binnedTriangle {
+		//Edge functions and depth, each as a*x+b*y+c in pixels
+		float edges[3][3], depth[3];
+		int minX, minY, maxX, maxY;
+	};
+
+	unsigned width_, height_, tilesX, tilesY;
+	mat4 viewProjection;
+	std::vector<float> depth_, tileMaxDepth;
+	std::vector<binnedTriangle> triangles;
+	std::vector<std::vector<unsigned> > bins;
+	std::vector<vec4> clipVertices;
+	bool resolved;
+
+	void binTriangle(const vec4 & a, const vec4 & b, const vec4 & c);
+	void rasteriseTile(unsigned tile);
+	void resolve();
+
+public:
+	//The width and height are rounded up to whole tiles
+	OcclusionBuffer(unsigned width = 256, unsigned height = 128);
+
+	//Empties the buffer for a new frame. viewProjection takes positions into clip space, normally
+	//getMatrix(PROJECTION_MATRIX)*getMatrix(MODELVIEW_MATRIX) as objects are about to be drawn
+	void clear(const mat4 & viewProjection);
+
+	//Occluders should be solid and no larger than what they stand for. vertices start with an x, y, z position every
+	//stride floats, and are moved by transformation before viewProjection
+	void drawTriangles(const float * vertices, unsigned vertexCount, unsigned stride, const unsigned * indices,
+			unsigned indexCount, const mat4 & transformation);
+	void drawBox(const boundingBox & box, const mat4 & transformation);
+	//Draws the full detail triangles of the object's model, in its rest pose, where it will be drawn. Simplified levels
+	//of detail can cover gaps in the model so they are never used. Prefer simple closed models as occluders, since the
+	//cost is per triangle. Sprites are not drawn
+	void drawObject(Object & object);
+
+	//False if every pixel the box covers is behind an occluder, or it is off screen
+	bool boxVisible(const boundingBox & box, const mat4 & transformation);
+	//Tests the bounds of the object's model where it will be drawn. Objects without a model are always visible
+	bool objectVisible(Object & object);
+
+	unsigned width(), height();
+	//Depth from 0 at the near plane to 1 at the far plane, where nothing has been drawn
+	float depth(unsigned x, unsigned y);
+	unsigned triangleCount();
+};
+
+}
+
+#endif /* OCCLUSIONBUFFER_H_ */
@@ -30,7 +30,10 @@ enum shaderAttributeEnum {
 	EXTRA1_ATTRIBUTE,
 	EXTRA2_ATTRIBUTE,
 	EXTRA3_ATTRIBUTE,
-	EXTRA4_ATTRIBUTE
+	EXTRA4_ATTRIBUTE,
+	//Per instance attributes for Model::drawInstanced. The matrix takes four locations, one for each column
+	INSTANCE_MATRIX_ATTRIBUTE,
+	INSTANCE_DATA_ATTRIBUTE = INSTANCE_MATRIX_ATTRIBUTE+4
 };
 
 enum shaderLocationEnum {
@@ -48,9 +51,23 @@ enum shaderLocationEnum {
 	EXTRA8_LOCATION,
 	EXTRA9_LOCATION,
 	TEXCOMPAT_LOCATION,
+	BONESAMPLER_LOCATION,
+	BONEOFFSET_LOCATION,
 	SHADER_LOCATION_ENUM_COUNT
 };
 
+//Uniform block binding points. FRAME_UNIFORM_BLOCK is filled by the library when frame uniforms are enabled (see
+//enableFrameUniforms in Display.h), and MATERIAL_UNIFORM_BLOCK by models with compact vertices (see
+//enableCompactVertices)
+enum shaderUniformBlockEnum {
+	FRAME_UNIFORM_BLOCK = 0,
+	MATERIAL_UNIFORM_BLOCK,
+	EXTRA0_UNIFORM_BLOCK,
+	EXTRA1_UNIFORM_BLOCK,
+	EXTRA2_UNIFORM_BLOCK,
+	SHADER_UNIFORM_BLOCK_ENUM_COUNT
+};
+
 class Sprite;
 class Model;
 class Font;
@@ -59,9 +76,20 @@ struct vec3;
 struct vec4;
 
 class Shader {
+	//CPU copy of the last value sent to each uniform location, so repeated values can skip the GL call
+	struct uniformShadow {
+		int type;
+		std::vector<char> data;
+	};
+
 	GLuint program_;
-	GLint uniformLocation_[SHADER_LOCATION_ENUM_COUNT];
+	GLint uniformLocation_[SHADER_LOCATION_ENUM_COUNT], uniformBlockIndex_[SHADER_UNIFORM_BLOCK_ENUM_COUNT];
 	std::string name_;
+	mutable uniformShadow uniformShadow_[SHADER_LOCATION_ENUM_COUNT];
+	mutable unsigned uniformCacheHits_, uniformCacheMisses_;
+
+	void initUniforms();
+	bool uniformChanged(shaderLocationEnum location, int type, const void * data, unsigned size) const;
 
 public:
 	friend class Sprite;
@@ -83,7 +111,13 @@ public:
 	void use() const;
 	GLint setUniformLocation(shaderLocationEnum dstLocation, const std::string & locationName);
 	GLint uniformLocation(shaderLocationEnum location) const;
+	//Links the named uniform block in the shader to a binding point. Returns the block index, or -1 if the shader
+	//has no such block
+	GLint setUniformBlock(shaderUniformBlockEnum dstBlock, const std::string & blockName);
+	GLint uniformBlockIndex(shaderUniformBlockEnum block) const;
 
+	//These make the shader's program current first if the value has to be uploaded, so they can be called on any
+	//shader at any time
 	void setUniform1(shaderLocationEnum location, GLfloat * data, unsigned count = 1) const;
 	void setUniform2(shaderLocationEnum location, GLfloat * data, unsigned count = 1) const;
 	void setUniform3(shaderLocationEnum location, GLfloat * data, unsigned count = 1) const;
@@ -110,6 +144,19 @@ public:
 	void setUniform2(shaderLocationEnum location, const vec2 & data) const;
 	void setUniform3(shaderLocationEnum location, const vec3 & data) const;
 	void setUniform4(shaderLocationEnum location, const vec4 & data) const;
+
+	//Sets PROJECTION_LOCATION to the current projection matrix, unless frame uniforms are enabled and this shader
+	//has FRAME_UNIFORM_BLOCK linked, in which case the frame block is brought up to date instead
+	void setProjectionUniform() const;
+	//Binds the bone palette to BONE_TEXTURE_UNIT and sets BONESAMPLER_LOCATION to it and BONEOFFSET_LOCATION to
+	//offset (see enableBoneTextures in Display.h)
+	void setBonePaletteUniforms(unsigned offset) const;
+
+	//The setUniform functions only call into GL when the value differs from the last one set at that location.
+	//Invalidate the cache after setting uniforms on this program directly with GL
+	void invalidateUniformCache();
+	unsigned uniformCacheHits() const, uniformCacheMisses() const;
+	void resetUniformCacheCounters();
 };
 
 }
@@ -12,8 +12,7 @@
 
 #include <iostream>
 #include <vector>
-
-typedef unsigned GLuint;
+#include "TextureAtlas.h"
 
 namespace SuperMaximo {
 
@@ -22,7 +21,9 @@ class Shader;
 
 class Sprite {
 	std::string name_;
-	std::vector<GLuint> texture_;
+	TextureAtlas * atlas_;
+	bool ownsAtlas;
+	std::vector<atlasRect> frameRects;
 	unsigned frames, framerate_;
 	struct spriteRect {
 		int x, y;
@@ -36,8 +37,11 @@ class Sprite {
 public:
 	friend class Object;
 
+	//Frames are packed into atlas, or into an atlas of the sprite's own if it is NULL. Shaders read vec4 positions
+	//from VERTEX_ATTRIBUTE and the frame's texture coordinates from TEXTURE0_ATTRIBUTE
 	Sprite(const std::string & name, const std::string & fileName, int x = 0, int y = 0, int width = 0,
-			int height = 0, int frames = 1, unsigned framerate = 1, int originX = 0, int originY = 0);
+			int height = 0, int frames = 1, unsigned framerate = 1, int originX = 0, int originY = 0,
+			TextureAtlas * atlas = NULL);
 	~Sprite();
 
 	const std::string & name();
@@ -46,14 +50,18 @@ public:
 	void setFramerate(unsigned newFramerate);
 	unsigned framerate();
 
-	void draw(int x, int y, float depth, float rotation = 0.0f, float xScale = 1.0f, float yScale = 1.0f,
+	void draw(float x, float y, float depth, float rotation = 0.0f, float xScale = 1.0f, float yScale = 1.0f,
 			float alpha = 1.0f, unsigned frame = 1, Shader * shaderOverride = NULL);
 
 	void draw(Object & object);
 
 	int width(), height(), originX(), originY();
 
-	GLuint texture(unsigned frame);
+	TextureAtlas * atlas();
+	//Every frame is in the same texture, so texture(frame) only exists for older code
+	GLuint texture(), texture(unsigned frame);
+	GLenum textureTarget();
+	const atlasRect & frameRect(unsigned frame);
 
 	void bindShader(Shader * shader);
 	Shader * boundShader();
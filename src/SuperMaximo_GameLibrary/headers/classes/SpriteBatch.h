@@ -0,0 +1,76 @@
+//============================================================================
+// Name        : SpriteBatch.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary SpriteBatch class for drawing many sprites at once
+//============================================================================
+
+#ifndef SPRITEBATCH_H_
+#define SPRITEBATCH_H_
+
+#include <iostream>
+#include <vector>
+#include "../Display.h"
+
+namespace SuperMaximo {
+
+class Object;
+class Shader;
+class Sprite;
+class StreamBuffer;
+
+//Largest number of quads in one batch, so that indices fit in 16 bits
+const unsigned SPRITE_BATCH_MAX_CAPACITY = 16384;
+
+//Collects sprite quads, transformed on the CPU, and draws them with one glDrawElements call per run of sprites that
+//share a texture, shader and modelview matrix. Unlike Sprite::draw, the batch's shader reads a vec3 position from
+//VERTEX_ATTRIBUTE, texture coordinates from TEXTURE0_ATTRIBUTE (in texels for rectangle textures, 0 to 1 otherwise)
+//and a colour with the sprite's alpha from COLOR0_ATTRIBUTE. The projection matrix, blending and depth testing are
+//read when the batch is flushed. Batches are drawn when they are flushed, whether or not the render queue is enabled
+class SpriteBatch {
+	struct spriteVertex {
+		GLfloat x, y, z, s, t;
+		GLubyte color[4];
+	};
+
+	std::vector<spriteVertex> vertices;
+	unsigned capacity_;
+	GLuint vao, ibo, texture_;
+	StreamBuffer * streamBuffer;
+	GLenum textureTarget;
+	mat4 modelview;
+	Shader * shader_, * boundShader_;
+
+	void setAttributePointers(long offset);
+
+public:
+	SpriteBatch(unsigned capacity = 4096, Shader * shader = NULL);
+	//Flushes any quads still in the batch, so its shader and textures must still exist
+	~SpriteBatch();
+
+	//The shader is, in order of preference, shaderOverride, the batch's bound shader or the globally bound shader
+	void draw(Sprite * sprite, float x, float y, float depth, float rotation = 0.0f, float xScale = 1.0f,
+			float yScale = 1.0f, float alpha = 1.0f, unsigned frame = 0, Shader * shaderOverride = NULL);
+	//Uses the interpolated state of the object, like Sprite::draw, but not the object's bound shader
+	void draw(Object & object);
+
+	//Draws and empties the batch. This happens automatically when it fills up or the texture, shader or modelview
+	//matrix changes, and refreshScreen flushes every batch before the swap
+	void flush();
+
+	unsigned size();
+	unsigned capacity();
+
+	void bindShader(Shader * shader);
+	Shader * boundShader();
+};
+
+//Flushes every batch. Call this before changing state the batches read at flush time, or deleting a sprite that
+//might be batched
+void flushSpriteBatches();
+
+}
+
+#endif /* SPRITEBATCH_H_ */
@@ -0,0 +1,61 @@
+//============================================================================
+// Name        : StreamBuffer.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary StreamBuffer class for geometry rewritten every frame
+//============================================================================
+
+#ifndef STREAMBUFFER_H_
+#define STREAMBUFFER_H_
+
+#include <iostream>
+#include "../Display.h"
+
+namespace SuperMaximo {
+
+//Number of frames a stream buffer holds, so the CPU can write one while the GPU is still reading the two before it
+const unsigned STREAM_BUFFER_FRAMES = 3;
+
+//A buffer object used as a ring of STREAM_BUFFER_FRAMES regions, one per frame. Where buffer storage is supported it
+//stays mapped, and a fence placed at the end of each frame stops that region being written again while the GPU might
+//still be reading it. Otherwise writes go through glBufferSubData and the storage is orphaned each time the ring wraps
+//round. A frame that writes more than a region flushes the render queue, so no queued draw reads a region once it is
+//fenced or orphaned, and moves on to the next one early, which can wait for the GPU
+class StreamBuffer {
+	GLenum target_;
+	GLuint buffer_;
+	unsigned regionSize_, region, offset;
+	GLsync fences[STREAM_BUFFER_FRAMES];
+	unsigned char * mapping;
+
+	void nextRegion();
+
+public:
+	//regionSize is in bytes. target is where the buffer is bound to write it and should be where it is drawn from
+	StreamBuffer(unsigned regionSize, GLenum target = GL_ARRAY_BUFFER);
+	~StreamBuffer();
+
+	//Copies size bytes into the buffer at a multiple of alignment bytes, which should be the vertex size for data
+	//drawn with a first vertex, and returns that offset. The buffer is left bound to its target, but other GL state
+	//can change if the render queue is flushed, so write before setting up a draw. Returns -1 if size is larger than
+	//a region
+	long write(const void * data, unsigned size, unsigned alignment = 4);
+
+	//Fences this frame's region and moves on to the next if anything was written. Called for every stream buffer by
+	//refreshScreen after the render queue is flushed
+	void endFrame();
+
+	GLuint buffer();
+	GLenum target();
+	unsigned regionSize();
+	bool persistentlyMapped();
+};
+
+//Calls endFrame on every stream buffer
+void endStreamBufferFrames();
+
+}
+
+#endif /* STREAMBUFFER_H_ */
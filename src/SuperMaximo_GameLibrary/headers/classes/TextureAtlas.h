@@ -0,0 +1,71 @@
+//============================================================================
+// Name        : TextureAtlas.h
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary TextureAtlas class for packing images into one texture
+//============================================================================
+
+#ifndef TEXTUREATLAS_H_
+#define TEXTUREATLAS_H_
+
+#include <iostream>
+#include <vector>
+#include <SDL/SDL_video.h>
+#include "../Display.h"
+
+namespace SuperMaximo {
+
+//Where an image was put in an atlas. x, y, w and h are in texels. s0, t0, s1 and t1 are the texture coordinates of
+//the top left and bottom right corners: in texels for rectangle textures and from 0 to 1 otherwise
+struct atlasRect {
+	int x, y;
+	unsigned w, h;
+	float s0, t0, s1, t1;
+};
+
+//A single texture that images are packed into with the skyline bottom left heuristic, leaving padding texels
+//between them so linear filtering does not bleed one image into the next. The texture is a rectangle texture if
+//texture rectangles are enabled when the atlas is created. Space is only reclaimed by clearing the whole atlas
+class TextureAtlas {
+	struct skylineNode {
+		int x, y, width;
+	};
+
+	std::string name_;
+	GLuint texture_;
+	GLenum target_;
+	int width_, height_, padding_;
+	std::vector<skylineNode> skyline;
+	unsigned long long usedArea;
+
+	int fit(unsigned index, int width, int height);
+
+public:
+	operator GLuint() const;
+
+	TextureAtlas(const std::string & name, int width, int height, int padding = 1);
+	~TextureAtlas();
+
+	const std::string & name();
+
+	//Reserves space without uploading anything. Returns false, leaving rect alone, if the atlas is too full
+	bool pack(unsigned width, unsigned height, atlasRect * rect);
+	//Packs the width by height area of image with its top left corner at x, y, uploading it straight from the
+	//surface. Any of the area outside the image is left transparent
+	bool add(SDL_Surface * image, int x, int y, unsigned width, unsigned height, atlasRect * rect);
+	bool add(SDL_Surface * image, atlasRect * rect);
+	//Empties the atlas. Rects given out before are no longer valid
+	void clear();
+
+	GLuint texture();
+	GLenum target();
+	int width(), height(), padding();
+	//Fraction of the atlas area that has been packed, including padding
+	float occupancy();
+};
+
+}
+
+#endif /* TEXTUREATLAS_H_ */
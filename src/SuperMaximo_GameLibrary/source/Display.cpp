@@ -10,6 +10,10 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 using namespace std;
 
 #include <GL/glew.h>
@@ -18,356 +22,22 @@ using namespace std;
 #include <SDL/SDL_image.h>
 
 #include <SuperMaximo_GameLibrary/classes/Shader.h>
+#include <SuperMaximo_GameLibrary/classes/MatrixStack.h>
+#include <SuperMaximo_GameLibrary/classes/SpriteBatch.h>
+#include <SuperMaximo_GameLibrary/classes/StreamBuffer.h>
 #include <SuperMaximo_GameLibrary/Input.h>
 #include <SuperMaximo_GameLibrary/Utils.h>
 #include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/RenderQueue.h>
 
 namespace SuperMaximo {
 
-float & mat2::operator[](short i) {
-	return component[i];
-}
-
-mat2 mat2::operator*(const mat2 & otherMat) {
-	mat2 returnMatrix;
-	returnMatrix.component[0] = (component[0]*otherMat.component[0])+(component[2]*otherMat.component[1]);
-	returnMatrix.component[1] = (component[1]*otherMat.component[0])+(component[3]*otherMat.component[1]);
-
-	returnMatrix.component[2] = (component[0]*otherMat.component[2])+(component[2]*otherMat.component[3]);
-	returnMatrix.component[3] = (component[1]*otherMat.component[2])+(component[3]*otherMat.component[3]);
-
-	return returnMatrix;
-}
-
-mat2::operator float*() {
-	return component;
-}
-
-void mat2::initIdentity() {
-	component[0] = component[3] = 1.0f;
-	component[1] = component[2] = 0.0f;
-}
-
-float & mat3::operator[](short i) {
-	return component[i];
-}
-
-mat3 mat3::operator*(const mat3 & otherMat) {
-	mat3 returnMatrix;
-	returnMatrix.component[0] = (component[0]*otherMat.component[0])+(component[3]*otherMat.component[1])+
-			(component[6]*otherMat.component[2]);
-	returnMatrix.component[1] = (component[1]*otherMat.component[0])+(component[4]*otherMat.component[1])+
-			(component[7]*otherMat.component[2]);
-	returnMatrix.component[2] = (component[2]*otherMat.component[0])+(component[5]*otherMat.component[1])+
-			(component[8]*otherMat.component[2]);
-
-	returnMatrix.component[3] = (component[0]*otherMat.component[3])+(component[3]*otherMat.component[4])+
-			(component[6]*otherMat.component[5]);
-	returnMatrix.component[4] = (component[1]*otherMat.component[3])+(component[4]*otherMat.component[4])+
-			(component[7]*otherMat.component[5]);
-	returnMatrix.component[5] = (component[2]*otherMat.component[3])+(component[5]*otherMat.component[4])+
-			(component[8]*otherMat.component[5]);
-
-	returnMatrix.component[6] = (component[0]*otherMat.component[6])+(component[3]*otherMat.component[7])+
-			(component[6]*otherMat.component[8]);
-	returnMatrix.component[7] = (component[1]*otherMat.component[6])+(component[4]*otherMat.component[7])+
-			(component[7]*otherMat.component[8]);
-	returnMatrix.component[8] = (component[2]*otherMat.component[6])+(component[5]*otherMat.component[7])+
-			(component[8]*otherMat.component[8]);
-
-	return returnMatrix;
-}
-
-mat3::operator float*() {
-	return component;
-}
-
-void mat3::initIdentity() {
-	for (short i = 0; i < 9; i++) component[i] = 0.0f;
-	component[0] = 1.0f;
-	component[4] = 1.0f;
-	component[8] = 1.0f;
-}
-
-float & mat4::operator[](short i) {
-	return component[i];
-}
-
-mat4 mat4::operator*(const mat4 & otherMat) {
-	mat4 returnMatrix;
-	returnMatrix.component[0] = (component[0]*otherMat.component[0])+(component[4]*otherMat.component[1])+
-			(component[8]*otherMat.component[2])+(component[12]*otherMat.component[3]);
-	returnMatrix.component[1] = (component[1]*otherMat.component[0])+(component[5]*otherMat.component[1])+
-			(component[9]*otherMat.component[2])+(component[13]*otherMat.component[3]);
-	returnMatrix.component[2] = (component[2]*otherMat.component[0])+(component[6]*otherMat.component[1])+
-			(component[10]*otherMat.component[2])+(component[14]*otherMat.component[3]);
-	returnMatrix.component[3] = (component[3]*otherMat.component[0])+(component[7]*otherMat.component[1])+
-			(component[11]*otherMat.component[2])+(component[15]*otherMat.component[3]);
-
-	returnMatrix.component[4] = (component[0]*otherMat.component[4])+(component[4]*otherMat.component[5])+
-			(component[8]*otherMat.component[6])+(component[12]*otherMat.component[7]);
-	returnMatrix.component[5] = (component[1]*otherMat.component[4])+(component[5]*otherMat.component[5])+
-			(component[9]*otherMat.component[6])+(component[13]*otherMat.component[7]);
-	returnMatrix.component[6] = (component[2]*otherMat.component[4])+(component[6]*otherMat.component[5])+
-			(component[10]*otherMat.component[6])+(component[14]*otherMat.component[7]);
-	returnMatrix.component[7] = (component[3]*otherMat.component[4])+(component[7]*otherMat.component[5])+
-			(component[11]*otherMat.component[6])+(component[15]*otherMat.component[7]);
-
-	returnMatrix.component[8] = (component[0]*otherMat.component[8])+(component[4]*otherMat.component[9])+
-			(component[8]*otherMat.component[10])+(component[12]*otherMat.component[11]);
-	returnMatrix.component[9] = (component[1]*otherMat.component[8])+(component[5]*otherMat.component[9])+
-			(component[9]*otherMat.component[10])+(component[13]*otherMat.component[11]);
-	returnMatrix.component[10] = (component[2]*otherMat.component[8])+(component[6]*otherMat.component[9])+
-			(component[10]*otherMat.component[10])+(component[14]*otherMat.component[11]);
-	returnMatrix.component[11] = (component[3]*otherMat.component[8])+(component[7]*otherMat.component[9])+
-			(component[11]*otherMat.component[10])+(component[15]*otherMat.component[11]);
-
-	returnMatrix.component[12] = (component[0]*otherMat.component[12])+(component[4]*otherMat.component[13])+
-			(component[8]*otherMat.component[14])+(component[12]*otherMat.component[15]);
-	returnMatrix.component[13] = (component[1]*otherMat.component[12])+(component[5]*otherMat.component[13])+
-			(component[9]*otherMat.component[14])+(component[13]*otherMat.component[15]);
-	returnMatrix.component[14] = (component[2]*otherMat.component[12])+(component[6]*otherMat.component[13])+
-			(component[10]*otherMat.component[14])+(component[14]*otherMat.component[15]);
-	returnMatrix.component[15] = (component[3]*otherMat.component[12])+(component[7]*otherMat.component[13])+
-			(component[11]*otherMat.component[14])+(component[15]*otherMat.component[15]);
-
-	return returnMatrix;
-}
-
-mat4::operator float*() {
-	return component;
-}
-
-void mat4::initIdentity() {
-	for (short i = 0; i < 16; i++) component[i] = 0.0f;
-	component[0] = 1.0f;
-	component[5] = 1.0f;
-	component[10] = 1.0f;
-	component[15] = 1.0f;
-}
-
-vec2::vec2(float x, float y) : x(x), y(y) {}
-
-vec2 vec2::operator+(const vec2 & otherVector) {
-	return vec2(x+otherVector.x, y+otherVector.y);
-}
-
-vec2 vec2::operator-(const vec2 & otherVector) {
-	return vec2(x-otherVector.x, y-otherVector.y);
-}
-
-void vec2::operator+=(const vec2 & otherVector) {
-	x += otherVector.x;
-	y += otherVector.y;
-}
-
-void vec2::operator-=(const vec2 & otherVector) {
-	x -= otherVector.x;
-	y -= otherVector.y;
-}
-
-vec2 vec2::operator*(const mat2 & matrix) {
-	return vec2(
-		(x*matrix.component[0])+(y*matrix.component[2]),
-		(x*matrix.component[1])+(y*matrix.component[3]));
-}
-
-void vec2::operator*=(const mat2 & matrix) {
-	*this = (*this)*matrix;
-}
-
-vec2 vec2::operator*(float num) {
-	return vec2(x*num, y*num);
-}
-
-void vec2::operator*=(float num) {
-	x *= num, y *= num;
-}
-
-vec2 vec2::operator/(float num) {
-	return vec2(x/num, y/num);
-}
-
-void vec2::operator/=(float num) {
-	x /= num, y /= num;
-}
-
-vec2 vec2::perpendicular() {
-	return vec2(-y, x);
-}
-
-float vec2::dotProduct(const vec2 & otherVector) {
-	return (x*otherVector.x)+(y*otherVector.y);
-}
-
-bool vec2::polygonCollision(unsigned vertexCount, ...) {
-	const unsigned maxVertices = 100;
-	if (vertexCount > maxVertices) vertexCount = maxVertices;
-
-	va_list vertexArgs;
-	va_start(vertexArgs, vertexCount);
-	vec2 vertices[maxVertices];
-	for (unsigned i = 0; i < vertexCount; i++) {
-		vertices[i] = va_arg(vertexArgs, vec2);
-	}
-	va_end(vertexArgs);
-
-	for (unsigned i = 1; i < vertexCount; i++) {
-		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
-	}
-	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
-		return false;
-
-	return true;
-}
-
-bool vec2::polygonCollision(unsigned vertexCount, vec2 * vertices) {
-	for (unsigned i = 1; i < vertexCount; i++) {
-		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
-	}
-	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
-		return false;
-
-	return true;
-}
-
-bool vec2::polygonCollision(unsigned vertexCount, std::vector<vec2> vertices) {
-	for (unsigned i = 1; i < vertexCount; i++) {
-		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
-	}
-	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
-		return false;
-
-	return true;
-}
-
-vec2::operator SuperMaximo::vec3() {
-	return vec3(x, y, 0.0f);
-}
-
-vec2::operator SuperMaximo::vec4() {
-	return vec4(x, y, 0.0f, 0.0f);
-}
-
-vec3::vec3(float x, float y, float z) : x(x), y(y), z(z) {}
-
-vec3 vec3::operator+(const vec3 & otherVector) {
-	return vec3(x+otherVector.x, y+otherVector.y, z+otherVector.z);
-}
-
-vec3 vec3::operator-(const vec3 & otherVector) {
-	return vec3(x-otherVector.x, y-otherVector.y, z-otherVector.z);
-}
-
-void vec3::operator+=(const vec3 & otherVector) {
-	x += otherVector.x;
-	y += otherVector.y;
-	z += otherVector.z;
-}
-
-void vec3::operator-=(const vec3 & otherVector) {
-	x -= otherVector.x;
-	y -= otherVector.y;
-	z -= otherVector.z;
-}
-
-vec3 vec3::operator*(float num) {
-	return vec3(x*num, y*num, z*num);
-}
-
-void vec3::operator*=(float num) {
-	x *= num, y *= num, z *= num;
-}
-
-vec3 vec3::operator/(float num) {
-	return vec3(x/num, y/num, z/num);
-}
-
-void vec3::operator/=(float num) {
-	x /= num, y /= num, z /= num;
-}
-
-float vec3::dotProduct(const vec3 & otherVector) {
-	return (x*otherVector.x)+(y*otherVector.y)+(z*otherVector.z);
-}
-
-vec3::operator SuperMaximo::vec2() {
-	return vec2(x, y);
-}
-
-vec3::operator SuperMaximo::vec4() {
-	return vec4(x, y, z, 0.0f);
-}
-
-vec4::vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
-
-vec4 vec4::operator+(const vec4 & otherVector) {
-	return vec4(x+otherVector.x, y+otherVector.y, z+otherVector.z, w+otherVector.w);
-}
-
-vec4 vec4::operator-(const vec4 & otherVector) {
-	return vec4(x-otherVector.x, y-otherVector.y, z-otherVector.z, w-otherVector.w);
-}
-
-void vec4::operator+=(const vec4 & otherVector) {
-	x += otherVector.x;
-	y += otherVector.y;
-	z += otherVector.z;
-	w += otherVector.w;
-}
-
-void vec4::operator-=(const vec4 & otherVector) {
-	x -= otherVector.x;
-	y -= otherVector.y;
-	z -= otherVector.z;
-	w -= otherVector.w;
-}
-
-vec4 vec4::operator*(const mat4 & matrix) {
-	vec4 returnVector;
-
-	returnVector.x = (x*matrix.component[0])+(y*matrix.component[4])+(z*matrix.component[8])+(w*matrix.component[12]);
-	returnVector.y = (x*matrix.component[1])+(y*matrix.component[5])+(z*matrix.component[9])+(w*matrix.component[13]);
-	returnVector.z = (x*matrix.component[2])+(y*matrix.component[6])+(z*matrix.component[10])+(w*matrix.component[14]);
-	returnVector.w = (x*matrix.component[3])+(y*matrix.component[7])+(z*matrix.component[11])+(w*matrix.component[15]);
-
-	return returnVector;
-}
-
-vec4 vec4::operator*(float num) {
-	return vec4(x*num, y*num, z*num, w*num);
-}
-
-void vec4::operator*=(float num) {
-	x *= num, y *= num, z *= num, w /= num;
-}
-
-vec4 vec4::operator/(float num) {
-	return vec4(x/num, y/num, z/num, w/num);
-}
-
-void vec4::operator/=(float num) {
-	x /= num, y /= num, z /= num, w /= num;
-}
-
-float vec4::dotProduct(const vec4 & otherVector) {
-	return (x*otherVector.x)+(y*otherVector.y)+(z*otherVector.z)+(w*otherVector.w);
-}
-
-vec4::operator SuperMaximo::vec2() {
-	return vec2(x, y);
-}
-
-vec4::operator SuperMaximo::vec3() {
-	return vec3(x, y, z);
-}
-
-
 static SDL_Surface * screen;
 static unsigned screenW, screenH, screenD, framerate = 0, maximumFramerate, idealFramerate = 60;
-static Uint32 ticks = 0;
-static mat4 matrix[MATRIX_STACK_COUNT+1];
-static vector<mat4> matrixStack[MATRIX_STACK_COUNT];
+static chrono::steady_clock::time_point frameStart;
+static MatrixStack defaultMatrixStack;
+static renderStats currentRenderStats_, lastRenderStats;
 
 bool initDisplay(unsigned width, unsigned height, unsigned depth, unsigned maxFramerate, bool fullScreen,
 		const string & windowTitle) {
@@ -381,23 +51,18 @@ bool initDisplay(unsigned width, unsigned height, unsigned depth, unsigned maxFr
 		screenW = width, screenH = height, screenD = depth;
 		maximumFramerate = maxFramerate;
 		if (maxFramerate > 0) idealFramerate = maxFramerate;
-		ticks = SDL_GetTicks();
+		frameStart = chrono::steady_clock::now();
 
 		if (glewInit() != GLEW_OK) return false;
 
 		glEnable(GL_DEPTH_TEST);
 		glDepthFunc(GL_LEQUAL);
 		glDisable(GL_BLEND);
+		invalidateStateCache();
 
-		matrix[IDENTITY_MATRIX].initIdentity();
-		matrix[MODELVIEW_MATRIX].initIdentity();
-		matrix[PERSPECTIVE_MATRIX] = getPerspectiveMatrix(45.0f, (float)width/(float)height, 1.0f, depth);
-		matrix[ORTHOGRAPHIC_MATRIX] = getOrthographicMatrix(0.0f, screenW, screenH, 0.0f, 1.0f, depth);
-
-		matrixStack[MODELVIEW_MATRIX].push_back(matrix[MODELVIEW_MATRIX]);
-		matrixStack[PERSPECTIVE_MATRIX].push_back(matrix[PERSPECTIVE_MATRIX]);
-		matrixStack[ORTHOGRAPHIC_MATRIX].push_back(matrix[ORTHOGRAPHIC_MATRIX]);
-		matrixStack[PROJECTION_MATRIX].push_back(matrix[PROJECTION_MATRIX]);
+		defaultMatrixStack.copy(getPerspectiveMatrix(45.0f, (float)width/(float)height, 1.0f, depth),
+				PERSPECTIVE_MATRIX);
+		defaultMatrixStack.copy(getOrthographicMatrix(0.0f, screenW, screenH, 0.0f, 1.0f, depth), ORTHOGRAPHIC_MATRIX);
 
 		glViewport(0, 0, width, height);
 
@@ -425,15 +90,19 @@ unsigned screenDepth() {
 }
 
 bool resizeScreen(unsigned width, unsigned height, bool fullScreen) {
-	if ((width > 0) && (height > 0) && (matrixStack[ORTHOGRAPHIC_MATRIX].size() == 1)) {
+	if ((width > 0) && (height > 0) && (defaultMatrixStack.depth(ORTHOGRAPHIC_MATRIX) == 0)) {
 		SDL_FreeSurface(screen);
 		if (fullScreen) screen = SDL_SetVideoMode(width, height, 32, SDL_OPENGL | SDL_FULLSCREEN);
 		else screen = SDL_SetVideoMode(width, height, 32, SDL_OPENGL);
 		if (screen == NULL) return false;
+		//Some platforms recreate the context here
+		invalidateStateCache();
 
 		screenW = width, screenH = height;
-		matrix[ORTHOGRAPHIC_MATRIX] = getOrthographicMatrix(0.0f, screenW, screenH, 0.0f, 1.0f, screenD);
-		matrix[PERSPECTIVE_MATRIX] = getPerspectiveMatrix(45.0f, (float)screenW/(float)screenH, 1.0f, screenD);
+		defaultMatrixStack.copy(getOrthographicMatrix(0.0f, screenW, screenH, 0.0f, 1.0f, screenD),
+				ORTHOGRAPHIC_MATRIX);
+		defaultMatrixStack.copy(getPerspectiveMatrix(45.0f, (float)screenW/(float)screenH, 1.0f, screenD),
+				PERSPECTIVE_MATRIX);
 		glViewport(0, 0, width, height);
 		return true;
 	}
@@ -516,15 +185,44 @@ mat4 getOrthographicMatrix(float left, float right, float bottom, float top, flo
 }
 
 mat2 get2dRotationMatrix(float angle) {
-	angle = (angle*pi)/180.0f;
+	float s, c;
+	sinCos(angle, &s, &c);
 
 	mat2 returnMatrix;
 
-	returnMatrix.component[0] = cos(angle);
-	returnMatrix.component[1] = sin(angle);
-	returnMatrix.component[2] = -sin(angle);
-	returnMatrix.component[3] = cos(angle);
+	returnMatrix.component[0] = c;
+	returnMatrix.component[1] = s;
+	returnMatrix.component[2] = -s;
+	returnMatrix.component[3] = c;
+
+	return returnMatrix;
+}
+
+mat4 getTransformationMatrix(const vec3 & position, const vec3 & rotation, const vec3 & scale) {
+	float cx, sx, cy, sy, cz, sz;
+	sinCos(rotation.x, &sx, &cx);
+	sinCos(rotation.y, &sy, &cy);
+	sinCos(rotation.z, &sz, &cz);
+	mat4 returnMatrix;
+	returnMatrix.component[0] = cy*cz*scale.x;
+	returnMatrix.component[1] = ((cx*sz)+(sx*sy*cz))*scale.x;
+	returnMatrix.component[2] = ((sx*sz)-(cx*sy*cz))*scale.x;
+	returnMatrix.component[3] = 0.0f;
+
+	returnMatrix.component[4] = -cy*sz*scale.y;
+	returnMatrix.component[5] = ((cx*cz)-(sx*sy*sz))*scale.y;
+	returnMatrix.component[6] = ((sx*cz)+(cx*sy*sz))*scale.y;
+	returnMatrix.component[7] = 0.0f;
+
+	returnMatrix.component[8] = sy*scale.z;
+	returnMatrix.component[9] = -sx*cy*scale.z;
+	returnMatrix.component[10] = cx*cy*scale.z;
+	returnMatrix.component[11] = 0.0f;
 
+	returnMatrix.component[12] = position.x;
+	returnMatrix.component[13] = position.y;
+	returnMatrix.component[14] = position.z;
+	returnMatrix.component[15] = 1.0f;
 	return returnMatrix;
 }
 
@@ -555,112 +253,234 @@ textureUnitEnum boundTextureUnit() {
 }
 
 
-static matrixEnum currentMatrixId = MODELVIEW_MATRIX;
+//Bindings that are not known, after invalidateStateCache or when the element array binding changes with the vertex
+//array, are set to this so that the next bind always goes through
+const GLuint UNKNOWN_BINDING = ~0u;
+const unsigned CACHED_TEXTURE_UNITS = 16, CACHED_TEXTURE_TARGETS = 6, CACHED_BUFFER_TARGETS = 8;
+
+static GLuint boundProgram_ = 0, boundVertexArray_ = 0, boundTextures[CACHED_TEXTURE_UNITS][CACHED_TEXTURE_TARGETS],
+	boundBuffers[CACHED_BUFFER_TARGETS];
+
+static int textureTargetIndex(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_RECTANGLE: return 1;
+	case GL_TEXTURE_2D_ARRAY: return 2;
+	case GL_TEXTURE_CUBE_MAP: return 3;
+	case GL_TEXTURE_3D: return 4;
+	case GL_TEXTURE_BUFFER: return 5;
+	default: return -1;
+	}
+}
+
+static int bufferTargetIndex(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_UNIFORM_BUFFER: return 2;
+	case GL_TEXTURE_BUFFER: return 3;
+	case GL_PIXEL_UNPACK_BUFFER: return 4;
+	case GL_COPY_READ_BUFFER: return 5;
+	case GL_COPY_WRITE_BUFFER: return 6;
+	case GL_DRAW_INDIRECT_BUFFER: return 7;
+	default: return -1;
+	}
+}
+
+void bindProgram(GLuint program) {
+	if (program == boundProgram_) return;
+	glUseProgram(program);
+	boundProgram_ = program;
+	currentRenderStats_.programSwitches++;
+}
+
+GLuint boundProgram() {
+	return boundProgram_;
+}
+
+void bindTexture(GLenum target, GLuint texture) {
+	int index = textureTargetIndex(target);
+	GLuint * binding = (index < 0) ? NULL : &boundTextures[boundTextureUnit_-TEXTURE0][index];
+	if ((binding != NULL) && (*binding == texture)) return;
+	glBindTexture(target, texture);
+	if (binding != NULL) *binding = texture;
+	currentRenderStats_.textureBinds++;
+}
+
+GLuint boundTexture(GLenum target) {
+	int index = textureTargetIndex(target);
+	return (index < 0) ? UNKNOWN_BINDING : boundTextures[boundTextureUnit_-TEXTURE0][index];
+}
+
+void bindVertexArray(GLuint vertexArray) {
+	if (vertexArray == boundVertexArray_) return;
+	glBindVertexArray(vertexArray);
+	boundVertexArray_ = vertexArray;
+	boundBuffers[1] = UNKNOWN_BINDING;
+	currentRenderStats_.vertexArrayBinds++;
+}
+
+GLuint boundVertexArray() {
+	return boundVertexArray_;
+}
+
+void bindBuffer(GLenum target, GLuint buffer) {
+	int index = bufferTargetIndex(target);
+	if ((index >= 0) && (boundBuffers[index] == buffer)) return;
+	glBindBuffer(target, buffer);
+	if (index >= 0) boundBuffers[index] = buffer;
+	currentRenderStats_.bufferBinds++;
+}
+
+GLuint boundBuffer(GLenum target) {
+	int index = bufferTargetIndex(target);
+	return (index < 0) ? UNKNOWN_BINDING : boundBuffers[index];
+}
+
+void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	glBindBufferBase(target, index, buffer);
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0) boundBuffers[targetIndex] = buffer;
+	currentRenderStats_.bufferBinds++;
+}
+
+void deleteProgram(GLuint program) {
+	glDeleteProgram(program);
+	if (program == boundProgram_) boundProgram_ = UNKNOWN_BINDING;
+}
+
+void deleteTexture(GLuint texture) {
+	glDeleteTextures(1, &texture);
+	for (unsigned i = 0; i < CACHED_TEXTURE_UNITS; i++) {
+		for (unsigned j = 0; j < CACHED_TEXTURE_TARGETS; j++) if (boundTextures[i][j] == texture) boundTextures[i][j] = 0;
+	}
+}
+
+void deleteVertexArray(GLuint vertexArray) {
+	glDeleteVertexArrays(1, &vertexArray);
+	if (vertexArray == boundVertexArray_) {
+		boundVertexArray_ = 0;
+		boundBuffers[1] = UNKNOWN_BINDING;
+	}
+}
+
+void deleteBuffer(GLuint buffer) {
+	glDeleteBuffers(1, &buffer);
+	for (unsigned i = 0; i < CACHED_BUFFER_TARGETS; i++) if (boundBuffers[i] == buffer) boundBuffers[i] = 0;
+}
+
+
+static thread_local MatrixStack * boundMatrixStack_ = &defaultMatrixStack;
+
+void bindMatrixStack(MatrixStack * matrixStack) {
+	boundMatrixStack_ = matrixStack != NULL ? matrixStack : &defaultMatrixStack;
+}
+
+MatrixStack * boundMatrixStack() {
+	return boundMatrixStack_;
+}
 
 void setMatrix(matrixEnum matrixId) {
-	if (currentMatrixId != IDENTITY_MATRIX) currentMatrixId = matrixId;
+	boundMatrixStack_->setCurrent(matrixId);
 }
 
 matrixEnum currentMatrix() {
-	return currentMatrixId;
+	return boundMatrixStack_->current();
 }
 
 void copyMatrix(matrixEnum srcMatrixId, matrixEnum dstMatrixId) {
-	if (dstMatrixId == IDENTITY_MATRIX) return;
-	matrix[dstMatrixId] = matrix[srcMatrixId];
+	boundMatrixStack_->copy(srcMatrixId, dstMatrixId);
 }
 
 void copyMatrix(mat4 srcMatrix, matrixEnum dstMatrixId) {
-	if (dstMatrixId == IDENTITY_MATRIX) return;
-	matrix[dstMatrixId] = srcMatrix;
+	boundMatrixStack_->copy(srcMatrix, dstMatrixId);
 }
 
 mat4 getMatrix(matrixEnum matrixId) {
-	return matrix[matrixId];
+	return boundMatrixStack_->get(matrixId);
+}
+
+frustum getViewFrustum() {
+	return frustum(getMatrix(PROJECTION_MATRIX)*getMatrix(MODELVIEW_MATRIX));
 }
 
 void pushMatrix() {
-	matrixStack[currentMatrixId].push_back(matrix[currentMatrixId]);
+	boundMatrixStack_->push();
 }
 
 void popMatrix() {
-	matrix[currentMatrixId] = matrixStack[currentMatrixId].back();
-	if (matrixStack[currentMatrixId].size() > 1) matrixStack[currentMatrixId].pop_back();
+	boundMatrixStack_->pop();
 }
 
 void translateMatrix(float x, float y, float z) {
-	mat4 transformationMatrix;
-	transformationMatrix.initIdentity();
-	transformationMatrix.component[12] = x;
-	transformationMatrix.component[13] = y;
-	transformationMatrix.component[14] = z;
-	matrix[currentMatrixId] = matrix[currentMatrixId]*transformationMatrix;
+	boundMatrixStack_->translate(x, y, z);
 }
 
 void rotateMatrix(float angle, float x, float y, float z) {
-	angle = (angle*pi)/180.0f;
-	float len = sqrt((x*x)+(y*y)+(z*z));
-	x /= len;
-	y /= len;
-	z /= len;
-	mat4 transformationMatrix;
-
-	float c = cos(angle), s = sin(angle), x2 = x*x, y2 = y*y, z2 = z*z;
-	float t = 1.0f-c;
-
-	transformationMatrix.component[0] = (x2*t)+c;
-	transformationMatrix.component[1] = (y*x*t)+z*s;
-	transformationMatrix.component[2] = (x*z*t)-(y*s);
-	transformationMatrix.component[3] = 0.0f;
-
-	transformationMatrix.component[4] = (x*y*t)-(z*s);
-	transformationMatrix.component[5] = (y2*t)+c;
-	transformationMatrix.component[6] = (y*z*t)+(x*s);
-	transformationMatrix.component[7] = 0.0f;
-
-	transformationMatrix.component[8] = (x*z*t)+(y*s);
-	transformationMatrix.component[9] = (y*z*t)-(x*s);
-	transformationMatrix.component[10] = (z2*t)+c;
-	transformationMatrix.component[11] = 0.0f;
-
-	transformationMatrix.component[12] = 0.0f;
-	transformationMatrix.component[13] = 0.0f;
-	transformationMatrix.component[14] = 0.0f;
-	transformationMatrix.component[15] = 1.0f;
+	boundMatrixStack_->rotate(angle, x, y, z);
+}
 
-	matrix[currentMatrixId] = matrix[currentMatrixId]*transformationMatrix;
+void rotateMatrix(float angle, axisEnum axis) {
+	boundMatrixStack_->rotate(angle, axis);
 }
 
 void scaleMatrix(float xScale, float yScale, float zScale) {
-	mat4 transformationMatrix;
-	transformationMatrix.initIdentity();
-	transformationMatrix.component[0] = xScale;
-	transformationMatrix.component[5] = yScale;
-	transformationMatrix.component[10] = zScale;
-	matrix[currentMatrixId] = matrix[currentMatrixId]*transformationMatrix;
+	boundMatrixStack_->scale(xScale, yScale, zScale);
 }
 
+void transformMatrix(const vec3 & position, const vec3 & rotation, const vec3 & scale) {
+	boundMatrixStack_->transform(position, rotation, scale);
+}
+
+void multiplyMatrix(const mat4 & otherMatrix) {
+	boundMatrixStack_->multiply(otherMatrix);
+}
 
-static Uint32 lastTicks = 0;
 static unsigned tickDifference = 1;
-static float compensation_ = 1.0f;
+static float compensation_ = 1.0f, frameTime_ = 0.0f;
+static chrono::microseconds frameSleepSlack_(1500);
+static float frameHistory[FRAME_HISTORY_LENGTH];
+static unsigned frameHistoryCount = 0, frameHistoryNext = 0;
+
+//Sleeps until shortly before the deadline, as sleeps can overshoot by a millisecond or more, then spins for the rest
+static void waitUntil(chrono::steady_clock::time_point deadline) {
+	chrono::steady_clock::time_point sleepDeadline = deadline-frameSleepSlack_;
+	if (chrono::steady_clock::now() < sleepDeadline) this_thread::sleep_until(sleepDeadline);
+	while (chrono::steady_clock::now() < deadline);
+}
 
 void refreshScreen() {
-	SDL_GL_SwapBuffers();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	resetEvents();
+	{
+		SM_PROFILE_SCOPE("refreshScreen");
+		flushSpriteBatches();
+		flushRenderQueue();
+		endStreamBufferFrames();
+		SDL_GL_SwapBuffers();
+		lastRenderStats = currentRenderStats_;
+		memset(&currentRenderStats_, 0, sizeof(renderStats));
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		resetEvents();
 
-	lastTicks = ticks;
-	ticks = SDL_GetTicks();
-	tickDifference = ticks-lastTicks;
-	if (tickDifference == 0) tickDifference = 1;
-	framerate = 1000.0f/tickDifference;
-	int delay = maximumFramerate > 0 ? (1000/maximumFramerate)-tickDifference : 0;
-	if (delay > 0) {
-		Uint32 time = ticks+delay;
-		while (SDL_GetTicks() < time);
+		if (maximumFramerate > 0) {
+			SM_PROFILE_SCOPE("waitForFrame");
+			waitUntil(frameStart+chrono::nanoseconds(1000000000/maximumFramerate));
+		}
 	}
-	compensation_ = float(tickDifference*idealFramerate)/1000.0f;
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double frameNanoseconds = chrono::duration<double, nano>(now-frameStart).count();
+	if (frameNanoseconds < 1.0) frameNanoseconds = 1.0;
+	frameStart = now;
+
+	frameTime_ = frameNanoseconds/1000000.0;
+	frameHistory[frameHistoryNext] = frameTime_;
+	frameHistoryNext = (frameHistoryNext+1) % FRAME_HISTORY_LENGTH;
+	if (frameHistoryCount < FRAME_HISTORY_LENGTH) frameHistoryCount++;
+
+	tickDifference = frameTime_+0.5f;
+	if (tickDifference == 0) tickDifference = 1;
+	framerate = 1000000000.0/frameNanoseconds;
+	compensation_ = (frameNanoseconds*idealFramerate)/1000000000.0;
+	endProfilerFrame();
 }
 
 unsigned getFramerate() {
@@ -684,16 +504,118 @@ float compensation() {
 	return compensation_;
 }
 
+float getFrameTime() {
+	return frameTime_;
+}
+
+frameTimeStats getFrameTimeStats() {
+	frameTimeStats stats;
+	stats.count = frameHistoryCount;
+	stats.mean = stats.p50 = stats.p95 = stats.p99 = stats.max = 0.0f;
+	if (frameHistoryCount == 0) return stats;
+
+	float sorted[FRAME_HISTORY_LENGTH];
+	double total = 0.0;
+	for (unsigned i = 0; i < frameHistoryCount; i++) {
+		sorted[i] = frameHistory[i];
+		total += sorted[i];
+	}
+	sort(sorted, sorted+frameHistoryCount);
+	stats.mean = total/frameHistoryCount;
+	stats.p50 = sorted[((frameHistoryCount-1)*50)/100];
+	stats.p95 = sorted[((frameHistoryCount-1)*95)/100];
+	stats.p99 = sorted[((frameHistoryCount-1)*99)/100];
+	stats.max = sorted[frameHistoryCount-1];
+	return stats;
+}
+
+void clearFrameTimeStats() {
+	frameHistoryCount = frameHistoryNext = 0;
+}
+
+void setFrameSleepSlack(unsigned microseconds) {
+	frameSleepSlack_ = chrono::microseconds(microseconds);
+}
+
+unsigned frameSleepSlack() {
+	return frameSleepSlack_.count();
+}
+
+renderStats getRenderStats() {
+	return lastRenderStats;
+}
+
+renderStats & currentRenderStats() {
+	return currentRenderStats_;
+}
+
+
+static bool gameLoopRunning_ = false;
+static float interpolationAlpha_ = 1.0f;
+static unsigned long long simulationTick_ = 0;
+
+void runGameLoop(unsigned updateRate, bool (*updateFunction)(void*), void (*drawFunction)(void*), void * data,
+		unsigned maxUpdatesPerFrame) {
+	if ((updateRate == 0) || (updateFunction == NULL)) return;
+	if (maxUpdatesPerFrame == 0) maxUpdatesPerFrame = 1;
+	const double step = 1000000000.0/updateRate;
+	double accumulator = 0.0;
+	gameLoopRunning_ = true;
+	chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
+	while (true) {
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		accumulator += chrono::duration<double, nano>(now-lastTime).count();
+		lastTime = now;
+		if (accumulator > step*maxUpdatesPerFrame) accumulator = step*maxUpdatesPerFrame;
+
+		float frameCompensation = compensation_;
+		compensation_ = float(idealFramerate)/updateRate;
+		while (accumulator >= step) {
+			if (!updateFunction(data)) {
+				compensation_ = frameCompensation;
+				interpolationAlpha_ = 1.0f;
+				gameLoopRunning_ = false;
+				return;
+			}
+			simulationTick_++;
+			accumulator -= step;
+		}
+		compensation_ = frameCompensation;
+
+		interpolationAlpha_ = accumulator/step;
+		if (drawFunction != NULL) drawFunction(data);
+		refreshScreen();
+	}
+}
+
+bool gameLoopRunning() {
+	return gameLoopRunning_;
+}
+
+float interpolationAlpha() {
+	return interpolationAlpha_;
+}
+
+unsigned long long simulationTick() {
+	return simulationTick_;
+}
+
 
-static bool blendingEnabled_ = false;
+static bool blendingEnabled_ = false, blendStateKnown = false;
+static blendFuncEnum srcBlendFunc_ = ONE, dstBlendFunc_ = ZERO;
+static blendFuncEquEnum blendFuncEquation_ = FUNC_ADD;
 
 void enableBlending(blendFuncEnum srcBlendFunc, blendFuncEnum dstBlendFunc, blendFuncEquEnum blendFuncEquation) {
 	if (!blendingEnabled_) {
 		glEnable(GL_BLEND);
 		blendingEnabled_ = true;
 	}
+	if (blendStateKnown && (srcBlendFunc == srcBlendFunc_) && (dstBlendFunc == dstBlendFunc_) &&
+			(blendFuncEquation == blendFuncEquation_)) return;
 	glBlendEquation(blendFuncEquation);
 	glBlendFunc(srcBlendFunc, dstBlendFunc);
+	srcBlendFunc_ = srcBlendFunc, dstBlendFunc_ = dstBlendFunc, blendFuncEquation_ = blendFuncEquation;
+	blendStateKnown = true;
 }
 
 void disableBlending() {
@@ -707,6 +629,10 @@ bool blendingEnabled() {
 	return blendingEnabled_;
 }
 
+void getBlendFunc(blendFuncEnum * srcBlendFunc, blendFuncEnum * dstBlendFunc, blendFuncEquEnum * blendFuncEquation) {
+	*srcBlendFunc = srcBlendFunc_, *dstBlendFunc = dstBlendFunc_, *blendFuncEquation = blendFuncEquation_;
+}
+
 
 static bool depthTestingEnabled_ = true;
 
@@ -728,6 +654,19 @@ bool depthTestingEnabled() {
 	return depthTestingEnabled_;
 }
 
+void invalidateStateCache() {
+	boundProgram_ = boundVertexArray_ = UNKNOWN_BINDING;
+	for (unsigned i = 0; i < CACHED_TEXTURE_UNITS; i++) {
+		for (unsigned j = 0; j < CACHED_TEXTURE_TARGETS; j++) boundTextures[i][j] = UNKNOWN_BINDING;
+	}
+	for (unsigned i = 0; i < CACHED_BUFFER_TARGETS; i++) boundBuffers[i] = UNKNOWN_BINDING;
+	glActiveTexture(TEXTURE0);
+	boundTextureUnit_ = TEXTURE0;
+	blendingEnabled_ = glIsEnabled(GL_BLEND);
+	depthTestingEnabled_ = glIsEnabled(GL_DEPTH_TEST);
+	blendStateKnown = false;
+}
+
 
 float openglVersion() {
 	static float version = 0.0f;
@@ -761,6 +700,185 @@ bool vertexArrayObjectSupported() {
 }
 
 
+bool uniformBufferObjectSupported() {
+	static bool supported = (openglVersion() >= 3.1f);
+	static bool checked = false;
+	if (!checked && !supported) {
+		string str = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+		supported = (str.find("GL_ARB_uniform_buffer_object") != string::npos);
+		checked = true;
+	}
+	return supported;
+}
+
+bool instancingSupported() {
+	static bool supported = (openglVersion() >= 3.3f);
+	static bool checked = false;
+	if (!checked && !supported) {
+		string str = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+		supported = ((str.find("GL_ARB_instanced_arrays") != string::npos)
+				&& (str.find("GL_ARB_draw_instanced") != string::npos) && vertexArrayObjectSupported());
+		checked = true;
+	}
+	return supported;
+}
+
+bool compactVerticesSupported() {
+	static bool supported = (openglVersion() >= 3.3f);
+	static bool checked = false;
+	if (!checked && !supported) {
+		string str = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+		supported = ((str.find("GL_ARB_vertex_type_2_10_10_10_rev") != string::npos)
+				&& (str.find("GL_ARB_half_float_vertex") != string::npos) && uniformBufferObjectSupported());
+		checked = true;
+	}
+	return supported;
+}
+
+bool textureBufferSupported() {
+	static bool supported = (openglVersion() >= 3.1f);
+	static bool checked = false;
+	if (!checked && !supported) {
+		string str = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+		supported = (str.find("GL_ARB_texture_buffer_object") != string::npos);
+		checked = true;
+	}
+	return supported;
+}
+
+bool bufferStorageSupported() {
+	static bool supported = (openglVersion() >= 4.4f);
+	static bool checked = false;
+	if (!checked && !supported) {
+		string str = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+		supported = ((str.find("GL_ARB_buffer_storage") != string::npos)
+				&& ((openglVersion() >= 3.2f) || (str.find("GL_ARB_sync") != string::npos)));
+		checked = true;
+	}
+	return supported;
+}
+
+
+struct frameUniformBlock {
+	mat4 projection;
+	vec4 screen;
+};
+
+static GLuint frameUniformBuffer = 0;
+static frameUniformBlock frameUniforms;
+static bool frameUniformsUploaded = false;
+
+void enableFrameUniforms() {
+	if (frameUniformBuffer != 0) return;
+	if (!uniformBufferObjectSupported()) {
+		cout << "Uniform buffer objects are not supported, frame uniforms will not be used" << endl;
+		return;
+	}
+	glGenBuffers(1, &frameUniformBuffer);
+	bindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BLOCK, frameUniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(frameUniformBlock), NULL, GL_DYNAMIC_DRAW);
+	frameUniformsUploaded = false;
+}
+
+void disableFrameUniforms() {
+	if (frameUniformBuffer == 0) return;
+	bindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BLOCK, 0);
+	deleteBuffer(frameUniformBuffer);
+	frameUniformBuffer = 0;
+}
+
+bool frameUniformsEnabled() {
+	return frameUniformBuffer != 0;
+}
+
+void updateFrameUniforms() {
+	if (frameUniformBuffer == 0) return;
+	frameUniformBlock block;
+	block.projection = getMatrix(PROJECTION_MATRIX);
+	block.screen = vec4(screenW, screenH, screenD, compensation_);
+	if (frameUniformsUploaded && (memcmp(&block, &frameUniforms, sizeof(frameUniformBlock)) == 0)) return;
+	frameUniforms = block;
+	bindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frameUniformBlock), &frameUniforms);
+	currentRenderStats_.bytesUploaded += sizeof(frameUniformBlock);
+	frameUniformsUploaded = true;
+}
+
+
+static bool compactVerticesEnabled_ = false;
+
+void enableCompactVertices() {
+	if (!compactVerticesSupported()) {
+		cout << "Packed vertex formats are not supported, models will use full size vertices" << endl;
+		return;
+	}
+	compactVerticesEnabled_ = true;
+}
+
+void disableCompactVertices() {
+	compactVerticesEnabled_ = false;
+}
+
+bool compactVerticesEnabled() {
+	return compactVerticesEnabled_;
+}
+
+
+static StreamBuffer * bonePalette = NULL;
+static GLuint bonePaletteTexture_ = 0;
+
+void enableBoneTextures(unsigned maxBonesPerFrame) {
+	if (bonePalette != NULL) return;
+	if (!textureBufferSupported()) {
+		cout << "Texture buffer objects are not supported, bone matrices will be uploaded as uniforms" << endl;
+		return;
+	}
+	//The texture views the whole ring, so every frame's palette has to fit in one texture buffer
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	unsigned maxBones = unsigned(maxTexels)/(4*STREAM_BUFFER_FRAMES);
+	if (maxBonesPerFrame > maxBones) maxBonesPerFrame = maxBones;
+	if (maxBonesPerFrame < 1) maxBonesPerFrame = 1;
+	bonePalette = new StreamBuffer(maxBonesPerFrame*sizeof(mat4), GL_TEXTURE_BUFFER);
+
+	glGenTextures(1, &bonePaletteTexture_);
+	textureUnitEnum previousTextureUnit = boundTextureUnit_;
+	bindTextureUnit(BONE_TEXTURE_UNIT);
+	bindTexture(GL_TEXTURE_BUFFER, bonePaletteTexture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, bonePalette->buffer());
+	bindTextureUnit(previousTextureUnit);
+}
+
+void disableBoneTextures() {
+	if (bonePalette == NULL) return;
+	//Queued draws may still read the palette
+	flushRenderQueue();
+	deleteTexture(bonePaletteTexture_);
+	bonePaletteTexture_ = 0;
+	delete bonePalette;
+	bonePalette = NULL;
+}
+
+bool boneTexturesEnabled() {
+	return bonePalette != NULL;
+}
+
+long writeBonePalette(const mat4 * bones, unsigned count) {
+	if ((bonePalette == NULL) || (count == 0)) return -1;
+	if (count*sizeof(mat4) > bonePalette->regionSize()) {
+		cout << "Cannot write " << count << " bone matrices to a palette of " << bonePalette->regionSize()/sizeof(mat4)
+				<< endl;
+		return -1;
+	}
+	long offset = bonePalette->write(bones, count*sizeof(mat4), sizeof(mat4));
+	return (offset < 0) ? -1 : offset/(4*sizeof(GLfloat));
+}
+
+GLuint bonePaletteTexture() {
+	return bonePaletteTexture_;
+}
+
+
 static bool texture2dArrayDisabled_ = false;
 
 void enableTexture2dArray() {
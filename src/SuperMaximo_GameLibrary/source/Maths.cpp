@@ -0,0 +1,394 @@
+//============================================================================
+// Name        : Maths.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary vector and matrix types
+//============================================================================
+
+#include <vector>
+#include <cstdarg>
+using namespace std;
+
+#include <SuperMaximo_GameLibrary/Maths.h>
+#include <SuperMaximo_GameLibrary/Utils.h>
+
+namespace SuperMaximo {
+
+bool vec2::polygonCollision(unsigned vertexCount, ...) const {
+	const unsigned maxVertices = 100;
+	if (vertexCount > maxVertices) vertexCount = maxVertices;
+
+	va_list vertexArgs;
+	va_start(vertexArgs, vertexCount);
+	vec2 vertices[maxVertices];
+	for (unsigned i = 0; i < vertexCount; i++) {
+		vertices[i] = va_arg(vertexArgs, vec2);
+	}
+	va_end(vertexArgs);
+
+	for (unsigned i = 1; i < vertexCount; i++) {
+		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
+	}
+	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
+		return false;
+
+	return true;
+}
+
+bool vec2::polygonCollision(unsigned vertexCount, const vec2 * vertices) const {
+	for (unsigned i = 1; i < vertexCount; i++) {
+		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
+	}
+	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
+		return false;
+
+	return true;
+}
+
+bool vec2::polygonCollision(unsigned vertexCount, const vector<vec2> & vertices) const {
+	for (unsigned i = 1; i < vertexCount; i++) {
+		if ((vertices[i-1]-(*this)).dotProduct((vertices[i]-vertices[i-1]).perpendicular()) < 0.0f) return false;
+	}
+	if ((vertices[vertexCount-1]-(*this)).dotProduct((vertices[0]-vertices[vertexCount-1]).perpendicular()) < 0.0f)
+		return false;
+
+	return true;
+}
+
+void transformPoints(const mat4 & matrix, const vec4 * points, vec4 * result, unsigned count) {
+	for (unsigned i = 0; i < count; i++) multiplyMat4Vec4(matrix.component, &points[i].x, &result[i].x);
+}
+
+void transformPoints(const mat4 & matrix, const vec3 * points, vec3 * result, unsigned count) {
+	const float * m = matrix.component;
+	unsigned i = 0;
+#if defined(SM_SIMD_SSE)
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m4 = _mm_set1_ps(m[4]),
+		m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]),
+		m10 = _mm_set1_ps(m[10]), m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+	//Four vec3s occupy three registers, which are shuffled into x, y and z registers and back again
+	for (; i+4 <= count; i += 4) {
+		const float * in = &points[i].x;
+		__m128 a = _mm_loadu_ps(in), b = _mm_loadu_ps(in+4), c = _mm_loadu_ps(in+8);
+		__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+				_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m128 resultX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_add_ps(_mm_mul_ps(z, m8), m12));
+		__m128 resultY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_add_ps(_mm_mul_ps(z, m9), m13));
+		__m128 resultZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)),
+				_mm_add_ps(_mm_mul_ps(z, m10), m14));
+
+		float * out = &result[i].x;
+		_mm_storeu_ps(out, _mm_shuffle_ps(_mm_shuffle_ps(resultX, resultY, _MM_SHUFFLE(0, 0, 0, 0)),
+				_mm_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(out+4, _mm_shuffle_ps(_mm_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(1, 1, 1, 1)),
+				_mm_shuffle_ps(resultX, resultY, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(out+8, _mm_shuffle_ps(_mm_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(3, 3, 2, 2)),
+				_mm_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+#endif
+	for (; i < count; i++) {
+		float x = points[i].x, y = points[i].y, z = points[i].z;
+		result[i].x = (x*m[0])+(y*m[4])+(z*m[8])+m[12];
+		result[i].y = (x*m[1])+(y*m[5])+(z*m[9])+m[13];
+		result[i].z = (x*m[2])+(y*m[6])+(z*m[10])+m[14];
+	}
+}
+
+void transformPoints(const mat2 & matrix, const vec2 * points, vec2 * result, unsigned count) {
+	const float * m = matrix.component;
+	unsigned i = 0;
+#if defined(SM_SIMD_SSE)
+	__m128 column0 = _mm_setr_ps(m[0], m[1], m[0], m[1]), column1 = _mm_setr_ps(m[2], m[3], m[2], m[3]);
+	for (; i+2 <= count; i += 2) {
+		__m128 pair = _mm_loadu_ps(&points[i].x);
+		__m128 x = _mm_shuffle_ps(pair, pair, _MM_SHUFFLE(2, 2, 0, 0)), y = _mm_shuffle_ps(pair, pair,
+				_MM_SHUFFLE(3, 3, 1, 1));
+		_mm_storeu_ps(&result[i].x, _mm_add_ps(_mm_mul_ps(x, column0), _mm_mul_ps(y, column1)));
+	}
+#endif
+	for (; i < count; i++) {
+		float x = points[i].x, y = points[i].y;
+		result[i].x = (x*m[0])+(y*m[2]);
+		result[i].y = (x*m[1])+(y*m[3]);
+	}
+}
+
+void transformPoints(const mat4 & matrix, const float * x, const float * y, const float * z, float * xResult,
+		float * yResult, float * zResult, unsigned count) {
+	const float * m = matrix.component;
+	unsigned i = 0;
+#if defined(SM_SIMD_AVX)
+	__m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]),
+		m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]), m8 = _mm256_set1_ps(m[8]),
+		m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m12 = _mm256_set1_ps(m[12]),
+		m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]);
+	for (; i+8 <= count; i += 8) {
+		__m256 xs = _mm256_loadu_ps(x+i), ys = _mm256_loadu_ps(y+i), zs = _mm256_loadu_ps(z+i);
+		_mm256_storeu_ps(xResult+i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xs, m0), _mm256_mul_ps(ys, m4)),
+				_mm256_add_ps(_mm256_mul_ps(zs, m8), m12)));
+		_mm256_storeu_ps(yResult+i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xs, m1), _mm256_mul_ps(ys, m5)),
+				_mm256_add_ps(_mm256_mul_ps(zs, m9), m13)));
+		_mm256_storeu_ps(zResult+i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xs, m2), _mm256_mul_ps(ys, m6)),
+				_mm256_add_ps(_mm256_mul_ps(zs, m10), m14)));
+	}
+#elif defined(SM_SIMD_SSE)
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m4 = _mm_set1_ps(m[4]),
+		m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]),
+		m10 = _mm_set1_ps(m[10]), m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+	for (; i+4 <= count; i += 4) {
+		__m128 xs = _mm_loadu_ps(x+i), ys = _mm_loadu_ps(y+i), zs = _mm_loadu_ps(z+i);
+		_mm_storeu_ps(xResult+i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, m0), _mm_mul_ps(ys, m4)),
+				_mm_add_ps(_mm_mul_ps(zs, m8), m12)));
+		_mm_storeu_ps(yResult+i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, m1), _mm_mul_ps(ys, m5)),
+				_mm_add_ps(_mm_mul_ps(zs, m9), m13)));
+		_mm_storeu_ps(zResult+i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, m2), _mm_mul_ps(ys, m6)),
+				_mm_add_ps(_mm_mul_ps(zs, m10), m14)));
+	}
+#endif
+	for (; i < count; i++) {
+		float xValue = x[i], yValue = y[i], zValue = z[i];
+		xResult[i] = (xValue*m[0])+(yValue*m[4])+(zValue*m[8])+m[12];
+		yResult[i] = (xValue*m[1])+(yValue*m[5])+(zValue*m[9])+m[13];
+		zResult[i] = (xValue*m[2])+(yValue*m[6])+(zValue*m[10])+m[14];
+	}
+}
+
+void transformPoints(const mat2 & matrix, const float * x, const float * y, float * xResult, float * yResult,
+		unsigned count) {
+	const float * m = matrix.component;
+	unsigned i = 0;
+#if defined(SM_SIMD_AVX)
+	__m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]),
+		m3 = _mm256_set1_ps(m[3]);
+	for (; i+8 <= count; i += 8) {
+		__m256 xs = _mm256_loadu_ps(x+i), ys = _mm256_loadu_ps(y+i);
+		_mm256_storeu_ps(xResult+i, _mm256_add_ps(_mm256_mul_ps(xs, m0), _mm256_mul_ps(ys, m2)));
+		_mm256_storeu_ps(yResult+i, _mm256_add_ps(_mm256_mul_ps(xs, m1), _mm256_mul_ps(ys, m3)));
+	}
+#elif defined(SM_SIMD_SSE)
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+	for (; i+4 <= count; i += 4) {
+		__m128 xs = _mm_loadu_ps(x+i), ys = _mm_loadu_ps(y+i);
+		_mm_storeu_ps(xResult+i, _mm_add_ps(_mm_mul_ps(xs, m0), _mm_mul_ps(ys, m2)));
+		_mm_storeu_ps(yResult+i, _mm_add_ps(_mm_mul_ps(xs, m1), _mm_mul_ps(ys, m3)));
+	}
+#endif
+	for (; i < count; i++) {
+		float xValue = x[i], yValue = y[i];
+		xResult[i] = (xValue*m[0])+(yValue*m[2]);
+		yResult[i] = (xValue*m[1])+(yValue*m[3]);
+	}
+}
+
+quat getRotationQuat(float xRot, float yRot, float zRot) {
+	float sx, cx, sy, cy, sz, cz;
+	sinCos(xRot*0.5f, &sx, &cx);
+	sinCos(yRot*0.5f, &sy, &cy);
+	sinCos(zRot*0.5f, &sz, &cz);
+	return quat(sx, 0.0f, 0.0f, cx)*quat(0.0f, sy, 0.0f, cy)*quat(0.0f, 0.0f, sz, cz);
+}
+
+quat slerp(const quat & a, const quat & b, float t) {
+	float cosAngle = a.dotProduct(b), bSign = 1.0f;
+	if (cosAngle < 0.0f) cosAngle = -cosAngle, bSign = -1.0f;
+	//Nearly parallel quaternions would divide by almost zero, and nlerp is exact enough there anyway
+	if (cosAngle > 0.9995f) return nlerp(a, b, t);
+	float angle = acos(cosAngle), sinAngle = sin(angle);
+	return (a*(sin((1.0f-t)*angle)/sinAngle))+(b*((bSign*sin(t*angle))/sinAngle));
+}
+
+//Adjusts t so that nlerp follows the constant angular velocity of slerp. d is the absolute dot product of the
+//quaternions. The polynomial fit is from "Approximating slerp" by Arseny Kapoulkine
+static inline float correctedSlerpStep(float t, float d) {
+	float a = 1.0904f+(d*(-3.2452f+(d*(3.55645f-(d*1.43519f)))));
+	float b = 0.848013f+(d*(-1.06021f+(d*0.215638f)));
+	float k = (a*(t-0.5f)*(t-0.5f))+b;
+	return t+(t*(t-0.5f)*(t-1.0f)*k);
+}
+
+static void interpolateQuats(const quat * a, const quat * b, const float * t, quat * result, unsigned count,
+		bool correct) {
+	unsigned i = 0;
+#if defined(SM_SIMD_SSE)
+	const __m128 signMask = _mm_set1_ps(-0.0f), half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f);
+	for (; i+4 <= count; i += 4) {
+		//Transpose four quaternions at a time so each register holds one component
+		__m128 ax = _mm_loadu_ps(&a[i].x), ay = _mm_loadu_ps(&a[i+1].x), az = _mm_loadu_ps(&a[i+2].x),
+			aw = _mm_loadu_ps(&a[i+3].x);
+		__m128 bx = _mm_loadu_ps(&b[i].x), by = _mm_loadu_ps(&b[i+1].x), bz = _mm_loadu_ps(&b[i+2].x),
+			bw = _mm_loadu_ps(&b[i+3].x);
+		_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+				_mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 sign = _mm_and_ps(dot, signMask);
+		bx = _mm_xor_ps(bx, sign), by = _mm_xor_ps(by, sign), bz = _mm_xor_ps(bz, sign), bw = _mm_xor_ps(bw, sign);
+
+		__m128 step = _mm_loadu_ps(t+i);
+		if (correct) {
+			__m128 d = _mm_andnot_ps(signMask, dot), offset = _mm_sub_ps(step, half);
+			__m128 aCoeff = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+			aCoeff = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, aCoeff));
+			aCoeff = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, aCoeff));
+			__m128 bCoeff = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+			bCoeff = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, bCoeff));
+			__m128 k = _mm_add_ps(_mm_mul_ps(aCoeff, _mm_mul_ps(offset, offset)), bCoeff);
+			step = _mm_add_ps(step, _mm_mul_ps(_mm_mul_ps(step, offset), _mm_mul_ps(_mm_sub_ps(step, one), k)));
+		}
+
+		__m128 rx = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), step)),
+			ry = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), step)),
+			rz = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), step)),
+			rw = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), step));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+				_mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+		rx = _mm_div_ps(rx, length), ry = _mm_div_ps(ry, length), rz = _mm_div_ps(rz, length),
+			rw = _mm_div_ps(rw, length);
+
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+		_mm_storeu_ps(&result[i].x, rx);
+		_mm_storeu_ps(&result[i+1].x, ry);
+		_mm_storeu_ps(&result[i+2].x, rz);
+		_mm_storeu_ps(&result[i+3].x, rw);
+	}
+#elif defined(SM_SIMD_NEON)
+	const float32x4_t half = vdupq_n_f32(0.5f), one = vdupq_n_f32(1.0f);
+	const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+	for (; i+4 <= count; i += 4) {
+		float32x4x4_t aq = vld4q_f32(&a[i].x), bq = vld4q_f32(&b[i].x);
+		float32x4_t dot = vmulq_f32(aq.val[0], bq.val[0]);
+		for (short j = 1; j < 4; j++) dot = vmlaq_f32(dot, aq.val[j], bq.val[j]);
+		uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(dot), signMask);
+		for (short j = 0; j < 4; j++) bq.val[j] = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(bq.val[j]), sign));
+
+		float32x4_t step = vld1q_f32(t+i);
+		if (correct) {
+			float32x4_t d = vabsq_f32(dot), offset = vsubq_f32(step, half);
+			float32x4_t aCoeff = vmlsq_n_f32(vdupq_n_f32(3.55645f), d, 1.43519f);
+			aCoeff = vmlaq_f32(vdupq_n_f32(-3.2452f), d, aCoeff);
+			aCoeff = vmlaq_f32(vdupq_n_f32(1.0904f), d, aCoeff);
+			float32x4_t bCoeff = vmlaq_n_f32(vdupq_n_f32(-1.06021f), d, 0.215638f);
+			bCoeff = vmlaq_f32(vdupq_n_f32(0.848013f), d, bCoeff);
+			float32x4_t k = vmlaq_f32(bCoeff, aCoeff, vmulq_f32(offset, offset));
+			step = vmlaq_f32(step, vmulq_f32(step, offset), vmulq_f32(vsubq_f32(step, one), k));
+		}
+
+		float32x4x4_t rq;
+		float32x4_t lengthSquared = vdupq_n_f32(0.0f);
+		for (short j = 0; j < 4; j++) {
+			rq.val[j] = vmlaq_f32(aq.val[j], vsubq_f32(bq.val[j], aq.val[j]), step);
+			lengthSquared = vmlaq_f32(lengthSquared, rq.val[j], rq.val[j]);
+		}
+		//Reciprocal square root estimate refined with two Newton-Raphson steps
+		float32x4_t invLength = vrsqrteq_f32(lengthSquared);
+		invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSquared, invLength), invLength));
+		invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSquared, invLength), invLength));
+		for (short j = 0; j < 4; j++) rq.val[j] = vmulq_f32(rq.val[j], invLength);
+		vst4q_f32(&result[i].x, rq);
+	}
+#endif
+	for (; i < count; i++) {
+		float d = a[i].dotProduct(b[i]), bSign = d < 0.0f ? -1.0f : 1.0f;
+		float step = correct ? correctedSlerpStep(t[i], fabs(d)) : t[i];
+		result[i] = ((a[i]*(1.0f-step))+(b[i]*(step*bSign))).normalised();
+	}
+}
+
+void nlerp(const quat * a, const quat * b, const float * t, quat * result, unsigned count) {
+	interpolateQuats(a, b, t, result, count, false);
+}
+
+void slerp(const quat * a, const quat * b, const float * t, quat * result, unsigned count) {
+	interpolateQuats(a, b, t, result, count, true);
+}
+
+frustum::frustum(const mat4 & matrix) {
+	//Gribb and Hartmann: each plane is the last row of the matrix plus or minus one of the others
+	const float * m = matrix.component;
+	vec4 row[4];
+	for (short i = 0; i < 4; i++) row[i] = vec4(m[i], m[4+i], m[8+i], m[12+i]);
+	for (short i = 0; i < 3; i++) {
+		planes[i*2] = row[3]+row[i];
+		planes[(i*2)+1] = row[3]-row[i];
+	}
+	for (short i = 0; i < 6; i++) {
+		float length = std::sqrt(vec3(planes[i].x, planes[i].y, planes[i].z).dotProduct(
+				vec3(planes[i].x, planes[i].y, planes[i].z)));
+		if (length > 0.0f) planes[i] /= length;
+	}
+}
+
+bool frustum::intersectsSphere(const vec3 & centre, float radius) const {
+	for (short i = 0; i < 6; i++) {
+		if (planes[i].dotProduct(vec4(centre.x, centre.y, centre.z, 1.0f)) < -radius) return false;
+	}
+	return true;
+}
+
+bool frustum::intersectsBox(const boundingBox & box) const {
+	for (short i = 0; i < 6; i++) {
+		//The corner furthest along the plane normal
+		vec4 corner(planes[i].x >= 0.0f ? box.maximum.x : box.minimum.x,
+				planes[i].y >= 0.0f ? box.maximum.y : box.minimum.y,
+				planes[i].z >= 0.0f ? box.maximum.z : box.minimum.z, 1.0f);
+		if (planes[i].dotProduct(corner) < 0.0f) return false;
+	}
+	return true;
+}
+
+unsigned cullSpheres(const frustum & viewFrustum, const float * x, const float * y, const float * z,
+		const float * radius, unsigned char * visible, unsigned count) {
+	unsigned i = 0, visibleCount = 0;
+#if defined(SM_SIMD_SSE)
+	const vec4 * planes = viewFrustum.planes;
+	for (; i+4 <= count; i += 4) {
+		__m128 xs = _mm_loadu_ps(x+i), ys = _mm_loadu_ps(y+i), zs = _mm_loadu_ps(z+i),
+			negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius+i));
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+		for (short j = 0; j < 6; j++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(planes[j].x)),
+					_mm_mul_ps(ys, _mm_set1_ps(planes[j].y))),
+					_mm_add_ps(_mm_mul_ps(zs, _mm_set1_ps(planes[j].z)), _mm_set1_ps(planes[j].w)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (short j = 0; j < 4; j++) {
+			visible[i+j] = (mask >> j) & 1;
+			visibleCount += visible[i+j];
+		}
+	}
+#elif defined(SM_SIMD_NEON)
+	const vec4 * planes = viewFrustum.planes;
+	for (; i+4 <= count; i += 4) {
+		float32x4_t xs = vld1q_f32(x+i), ys = vld1q_f32(y+i), zs = vld1q_f32(z+i),
+			negativeRadius = vnegq_f32(vld1q_f32(radius+i));
+		uint32x4_t inside = vdupq_n_u32(~0u);
+		for (short j = 0; j < 6; j++) {
+			float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(planes[j].w), xs, planes[j].x);
+			distance = vmlaq_n_f32(distance, ys, planes[j].y);
+			distance = vmlaq_n_f32(distance, zs, planes[j].z);
+			inside = vandq_u32(inside, vcgeq_f32(distance, negativeRadius));
+		}
+		unsigned lanes[4];
+		vst1q_u32(lanes, inside);
+		for (short j = 0; j < 4; j++) {
+			visible[i+j] = (lanes[j] != 0);
+			visibleCount += visible[i+j];
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		visible[i] = viewFrustum.intersectsSphere(vec3(x[i], y[i], z[i]), radius[i]);
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+}
@@ -0,0 +1,485 @@
+//============================================================================
+// Name        : Mesh.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary triangle mesh indexing and optimisation
+//============================================================================
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+#include <SuperMaximo_GameLibrary/Maths.h>
+#include <SuperMaximo_GameLibrary/Mesh.h>
+
+namespace SuperMaximo {
+
+const unsigned NO_VERTEX = ~0u;
+
+static unsigned hashVertex(const float * vertex, unsigned stride) {
+	//FNV-1a over the bits of the floats
+	unsigned hash = 2166136261u;
+	const unsigned char * bytes = (const unsigned char *)vertex;
+	for (unsigned i = 0; i < stride*sizeof(float); i++) hash = (hash ^ bytes[i])*16777619u;
+	return hash;
+}
+
+unsigned indexVertices(const float * vertices, unsigned vertexCount, unsigned stride, vector<float> * uniqueVertices,
+		vector<unsigned> * indices) {
+	unsigned tableSize = 1;
+	while (tableSize < vertexCount*2) tableSize *= 2;
+	vector<unsigned> table(tableSize, NO_VERTEX);
+
+	uniqueVertices->clear();
+	indices->resize(vertexCount);
+	unsigned uniqueCount = 0;
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const float * vertex = vertices+(i*stride);
+		//Open addressing with linear probing
+		unsigned slot = hashVertex(vertex, stride) & (tableSize-1);
+		while ((table[slot] != NO_VERTEX) &&
+				(memcmp(&(*uniqueVertices)[table[slot]*stride], vertex, stride*sizeof(float)) != 0)) {
+			slot = (slot+1) & (tableSize-1);
+		}
+		if (table[slot] == NO_VERTEX) {
+			table[slot] = uniqueCount++;
+			uniqueVertices->insert(uniqueVertices->end(), vertex, vertex+stride);
+		}
+		(*indices)[i] = table[slot];
+	}
+	return uniqueCount;
+}
+
+//Scores from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const unsigned FORSYTH_CACHE_SIZE = 32;
+
+static float forsythVertexScore(int cachePosition, unsigned remainingTriangles) {
+	if (remainingTriangles == 0) return -1.0f;
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		//The last triangle's vertices score the same so the next triangle is not biased towards any of its edges
+		if (cachePosition < 3) score = 0.75f; else {
+			float position = 1.0f-(float(cachePosition-3)/float(FORSYTH_CACHE_SIZE-3));
+			score = powf(position, 1.5f);
+		}
+	}
+	//Favour vertices with few triangles left, so lone triangles are not left until the end
+	return score+(2.0f/sqrtf(float(remainingTriangles)));
+}
+
+void optimiseVertexCache(unsigned * indices, unsigned indexCount, unsigned vertexCount) {
+	unsigned triangleCount = indexCount/3;
+	if (triangleCount == 0) return;
+
+	//Triangles using each vertex, packed into one array. remaining counts those not yet output, which are kept at
+	//the start of each vertex's range
+	vector<unsigned> triangleStart(vertexCount+1, 0), remaining(vertexCount, 0);
+	for (unsigned i = 0; i < triangleCount*3; i++) triangleStart[indices[i]+1]++;
+	for (unsigned i = 0; i < vertexCount; i++) triangleStart[i+1] += triangleStart[i];
+	vector<unsigned> vertexTriangles(triangleCount*3);
+	for (unsigned i = 0; i < triangleCount*3; i++) {
+		unsigned vertex = indices[i];
+		vertexTriangles[triangleStart[vertex]+remaining[vertex]++] = i/3;
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount), triangleScore(triangleCount, 0.0f);
+	for (unsigned i = 0; i < vertexCount; i++) vertexScore[i] = forsythVertexScore(-1, remaining[i]);
+	for (unsigned i = 0; i < triangleCount*3; i++) triangleScore[i/3] += vertexScore[indices[i]];
+
+	vector<bool> triangleAdded(triangleCount, false);
+	vector<unsigned> output(triangleCount*3);
+	unsigned cache[FORSYTH_CACHE_SIZE+3], newCache[FORSYTH_CACHE_SIZE+3], cacheSize = 0, nextUnadded = 0;
+
+	unsigned bestTriangle = 0;
+	for (unsigned i = 1; i < triangleCount; i++) {
+		if (triangleScore[i] > triangleScore[bestTriangle]) bestTriangle = i;
+	}
+
+	for (unsigned outputCount = 0; outputCount < triangleCount; outputCount++) {
+		triangleAdded[bestTriangle] = true;
+		const unsigned * triangle = indices+(bestTriangle*3);
+		for (unsigned i = 0; i < 3; i++) {
+			output[(outputCount*3)+i] = triangle[i];
+			unsigned vertex = triangle[i], start = triangleStart[vertex];
+			for (unsigned j = 0; j < remaining[vertex]; j++) {
+				if (vertexTriangles[start+j] == bestTriangle) {
+					vertexTriangles[start+j] = vertexTriangles[start+remaining[vertex]-1];
+					remaining[vertex]--;
+					break;
+				}
+			}
+		}
+
+		//Move the triangle's vertices to the front of the cache
+		unsigned newCacheSize = 0;
+		for (unsigned i = 0; i < 3; i++) {
+			if ((newCacheSize == 0) || (newCache[0] != triangle[i])) {
+				if ((newCacheSize < 2) || (newCache[1] != triangle[i])) newCache[newCacheSize++] = triangle[i];
+			}
+		}
+		for (unsigned i = 0; i < cacheSize; i++) {
+			unsigned vertex = cache[i];
+			if ((vertex != triangle[0]) && (vertex != triangle[1]) && (vertex != triangle[2])) {
+				newCache[newCacheSize++] = vertex;
+			}
+		}
+
+		//Rescore the cached vertices and their triangles, looking for the best triangle to add next
+		float bestScore = -1.0f;
+		for (unsigned i = 0; i < newCacheSize; i++) {
+			unsigned vertex = newCache[i];
+			cachePosition[vertex] = (i < FORSYTH_CACHE_SIZE) ? int(i) : -1;
+			float score = forsythVertexScore(cachePosition[vertex], remaining[vertex]);
+			float difference = score-vertexScore[vertex];
+			vertexScore[vertex] = score;
+			unsigned start = triangleStart[vertex];
+			for (unsigned j = 0; j < remaining[vertex]; j++) triangleScore[vertexTriangles[start+j]] += difference;
+		}
+		for (unsigned i = 0; i < newCacheSize; i++) {
+			unsigned vertex = newCache[i], start = triangleStart[vertex];
+			for (unsigned j = 0; j < remaining[vertex]; j++) {
+				unsigned otherTriangle = vertexTriangles[start+j];
+				if (triangleScore[otherTriangle] > bestScore) {
+					bestScore = triangleScore[otherTriangle];
+					bestTriangle = otherTriangle;
+				}
+			}
+		}
+		cacheSize = newCacheSize < FORSYTH_CACHE_SIZE ? newCacheSize : FORSYTH_CACHE_SIZE;
+		memcpy(cache, newCache, cacheSize*sizeof(unsigned));
+
+		//Nothing in the cache is connected to anything left, so start again from the next triangle not yet added
+		if (bestScore < 0.0f) {
+			while ((nextUnadded < triangleCount) && triangleAdded[nextUnadded]) nextUnadded++;
+			bestTriangle = nextUnadded;
+		}
+	}
+	memcpy(indices, &output[0], triangleCount*3*sizeof(unsigned));
+}
+
+//Simulates a FIFO cache by remembering when each vertex was last loaded, counted in misses
+struct fifoCache {
+	vector<unsigned> loadedAt;
+	unsigned misses, size;
+
+	fifoCache(unsigned vertexCount, unsigned size) : loadedAt(vertexCount, NO_VERTEX), misses(0), size(size) {}
+
+	bool access(unsigned vertex) {
+		if ((loadedAt[vertex] != NO_VERTEX) && (misses-loadedAt[vertex] < size)) return true;
+		loadedAt[vertex] = misses++;
+		return false;
+	}
+};
+
+struct triangleCluster {
+	unsigned start, end;
+	float sortKey;
+};
+
+static bool clusterComesFirst(const triangleCluster & a, const triangleCluster & b) {
+	return a.sortKey > b.sortKey;
+}
+
+void optimiseOverdraw(unsigned * indices, unsigned indexCount, const float * vertices, unsigned vertexCount,
+		unsigned stride) {
+	unsigned triangleCount = indexCount/3;
+	if (triangleCount < 2) return;
+
+	//A new cluster starts wherever a triangle misses the cache for all of its vertices
+	vector<triangleCluster> clusters;
+	fifoCache cache(vertexCount, 16);
+	for (unsigned i = 0; i < triangleCount; i++) {
+		unsigned misses = 0;
+		for (unsigned j = 0; j < 3; j++) if (!cache.access(indices[(i*3)+j])) misses++;
+		if ((i == 0) || (misses == 3)) {
+			if (!clusters.empty()) clusters.back().end = i;
+			triangleCluster cluster = {i, triangleCount, 0.0f};
+			clusters.push_back(cluster);
+		}
+	}
+	if (clusters.size() < 2) return;
+
+	vec3 meshCentre(0.0f, 0.0f, 0.0f);
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const float * position = vertices+(i*stride);
+		meshCentre += vec3(position[0], position[1], position[2]);
+	}
+	meshCentre /= float(vertexCount);
+
+	for (unsigned i = 0; i < clusters.size(); i++) {
+		vec3 centre(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+		float area = 0.0f;
+		for (unsigned j = clusters[i].start; j < clusters[i].end; j++) {
+			const float * a = vertices+(indices[j*3]*stride), * b = vertices+(indices[(j*3)+1]*stride),
+					* c = vertices+(indices[(j*3)+2]*stride);
+			vec3 p0(a[0], a[1], a[2]), p1(b[0], b[1], b[2]), p2(c[0], c[1], c[2]);
+			vec3 u = p1-p0, v = p2-p0;
+			vec3 triangleNormal((u.y*v.z)-(u.z*v.y), (u.z*v.x)-(u.x*v.z), (u.x*v.y)-(u.y*v.x));
+			//The cross product's length is twice the area, so this weights by area
+			float triangleArea = sqrtf(triangleNormal.dotProduct(triangleNormal));
+			centre += (p0+p1+p2)*(triangleArea/3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+		if (area > 0.0f) centre /= area;
+		float normalLength = sqrtf(normal.dotProduct(normal));
+		if (normalLength > 0.0f) normal /= normalLength;
+		clusters[i].sortKey = (centre-meshCentre).dotProduct(normal);
+	}
+	stable_sort(clusters.begin(), clusters.end(), clusterComesFirst);
+
+	vector<unsigned> output;
+	output.reserve(triangleCount*3);
+	for (unsigned i = 0; i < clusters.size(); i++) {
+		output.insert(output.end(), indices+(clusters[i].start*3), indices+(clusters[i].end*3));
+	}
+	memcpy(indices, &output[0], triangleCount*3*sizeof(unsigned));
+}
+
+void optimiseVertexFetch(unsigned * indices, unsigned indexCount, float * vertices, unsigned vertexCount,
+		unsigned stride) {
+	vector<unsigned> remap(vertexCount, NO_VERTEX);
+	unsigned nextVertex = 0;
+	for (unsigned i = 0; i < indexCount; i++) {
+		if (remap[indices[i]] == NO_VERTEX) remap[indices[i]] = nextVertex++;
+		indices[i] = remap[indices[i]];
+	}
+	//Unused vertices go at the end
+	for (unsigned i = 0; i < vertexCount; i++) if (remap[i] == NO_VERTEX) remap[i] = nextVertex++;
+
+	vector<float> reordered(vertexCount*stride);
+	for (unsigned i = 0; i < vertexCount; i++) {
+		memcpy(&reordered[remap[i]*stride], vertices+(i*stride), stride*sizeof(float));
+	}
+	memcpy(vertices, &reordered[0], reordered.size()*sizeof(float));
+}
+
+float averageCacheMissRatio(const unsigned * indices, unsigned indexCount, unsigned vertexCount, unsigned cacheSize) {
+	if (indexCount < 3) return 0.0f;
+	fifoCache cache(vertexCount, cacheSize);
+	for (unsigned i = 0; i < indexCount; i++) cache.access(indices[i]);
+	return float(cache.misses)/float(indexCount/3);
+}
+
+//Weighted sum of squared distances to a set of planes, as the symmetric matrix of Garland and Heckbert. Doubles, as
+//the terms for large models lose too much precision in floats
+struct quadric {
+	double aa, ab, ac, ad, bb, bc, bd, cc, cd, dd, weight;
+
+	quadric() : aa(0.0), ab(0.0), ac(0.0), ad(0.0), bb(0.0), bc(0.0), bd(0.0), cc(0.0), cd(0.0), dd(0.0),
+			weight(0.0) {}
+
+	void addPlane(double a, double b, double c, double d, double weight) {
+		aa += a*a*weight, ab += a*b*weight, ac += a*c*weight, ad += a*d*weight;
+		bb += b*b*weight, bc += b*c*weight, bd += b*d*weight;
+		cc += c*c*weight, cd += c*d*weight, dd += d*d*weight;
+		this->weight += weight;
+	}
+
+	void operator+=(const quadric & other) {
+		aa += other.aa, ab += other.ab, ac += other.ac, ad += other.ad, bb += other.bb, bc += other.bc;
+		bd += other.bd, cc += other.cc, cd += other.cd, dd += other.dd, weight += other.weight;
+	}
+
+	//The weighted mean of the squared distances, so the square root is a distance
+	double error(const float * position) const {
+		double x = position[0], y = position[1], z = position[2];
+		double result = (x*x*aa)+(2.0*x*y*ab)+(2.0*x*z*ac)+(2.0*x*ad)+(y*y*bb)+(2.0*y*z*bc)+(2.0*y*bd)+(z*z*cc)
+				+(2.0*z*cd)+dd;
+		return ((result > 0.0) && (weight > 0.0)) ? result/weight : 0.0;
+	}
+};
+
+struct edgeCollapse {
+	unsigned from, to;
+	double cost;
+};
+
+static bool collapseIsCheaper(const edgeCollapse & a, const edgeCollapse & b) {
+	return a.cost < b.cost;
+}
+
+static vec3 triangleNormal(const float * a, const float * b, const float * c) {
+	vec3 u(b[0]-a[0], b[1]-a[1], b[2]-a[2]), v(c[0]-a[0], c[1]-a[1], c[2]-a[2]);
+	return vec3((u.y*v.z)-(u.z*v.y), (u.z*v.x)-(u.x*v.z), (u.x*v.y)-(u.y*v.x));
+}
+
+unsigned simplifyMesh(const unsigned * indices, unsigned indexCount, const float * vertices, unsigned vertexCount,
+		unsigned stride, unsigned targetIndexCount, unsigned * result, float * resultError) {
+	indexCount -= indexCount%3;
+	memcpy(result, indices, indexCount*sizeof(unsigned));
+	if (resultError != NULL) *resultError = 0.0f;
+	if (indexCount <= targetIndexCount) return indexCount;
+
+	//Vertices split by a seam share a position but differ in their other attributes. They are found by hashing the
+	//positions alone
+	vector<unsigned> positionOf(vertexCount), table;
+	unsigned tableSize = 1;
+	while (tableSize < vertexCount*2) tableSize *= 2;
+	table.assign(tableSize, NO_VERTEX);
+	vector<unsigned> positionUses(vertexCount, 0);
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const float * position = vertices+(i*stride);
+		unsigned slot = hashVertex(position, 3) & (tableSize-1);
+		while ((table[slot] != NO_VERTEX) && (memcmp(vertices+(table[slot]*stride), position, sizeof(float)*3) != 0))
+			slot = (slot+1) & (tableSize-1);
+		if (table[slot] == NO_VERTEX) table[slot] = i;
+		positionOf[i] = table[slot];
+		positionUses[table[slot]]++;
+	}
+
+	//Seams, borders and non-manifold edges are locked in place, so the outline and the attribute boundaries of the
+	//mesh survive. Everything else collapses onto a neighbour
+	vector<unsigned long long> edges;
+	edges.reserve(indexCount);
+	for (unsigned i = 0; i < indexCount; i += 3) {
+		for (unsigned j = 0; j < 3; j++) {
+			unsigned a = positionOf[result[i+j]], b = positionOf[result[i+((j+1)%3)]];
+			if (a > b) swap(a, b);
+			edges.push_back((((unsigned long long)a) << 32) | b);
+		}
+	}
+	sort(edges.begin(), edges.end());
+	vector<bool> locked(vertexCount, false);
+	for (unsigned i = 0; i < edges.size();) {
+		unsigned j = i+1;
+		while ((j < edges.size()) && (edges[j] == edges[i])) j++;
+		if (j-i != 2) locked[unsigned(edges[i] >> 32)] = locked[unsigned(edges[i] & 0xffffffffu)] = true;
+		i = j;
+	}
+	for (unsigned i = 0; i < vertexCount; i++) {
+		if (locked[positionOf[i]] || (positionUses[positionOf[i]] > 1)) locked[i] = true;
+	}
+
+	vector<quadric> quadrics(vertexCount);
+	for (unsigned i = 0; i < indexCount; i += 3) {
+		const float * a = vertices+(result[i]*stride), * b = vertices+(result[i+1]*stride),
+			* c = vertices+(result[i+2]*stride);
+		vec3 normal = triangleNormal(a, b, c);
+		float length = sqrtf(normal.dotProduct(normal));
+		if (length == 0.0f) continue;
+		normal /= length;
+		double d = -((normal.x*a[0])+(normal.y*a[1])+(normal.z*a[2]));
+		//Weighted by area so small triangles do not outvote large ones
+		for (unsigned j = 0; j < 3; j++) quadrics[result[i+j]].addPlane(normal.x, normal.y, normal.z, d, length*0.5f);
+	}
+
+	vector<unsigned> remap(vertexCount), adjacencyStart(vertexCount+1), adjacency;
+	vector<bool> touched(vertexCount);
+	vector<edgeCollapse> collapses;
+	double largestError = 0.0;
+	while (indexCount > targetIndexCount) {
+		//Triangles around each vertex
+		adjacencyStart.assign(vertexCount+1, 0);
+		for (unsigned i = 0; i < indexCount; i++) adjacencyStart[result[i]+1]++;
+		for (unsigned i = 0; i < vertexCount; i++) adjacencyStart[i+1] += adjacencyStart[i];
+		adjacency.resize(indexCount);
+		vector<unsigned> fill(adjacencyStart.begin(), adjacencyStart.end()-1);
+		for (unsigned i = 0; i < indexCount; i++) adjacency[fill[result[i]]++] = i/3;
+
+		collapses.clear();
+		for (unsigned i = 0; i < indexCount; i += 3) {
+			for (unsigned j = 0; j < 3; j++) {
+				unsigned a = result[i+j], b = result[i+((j+1)%3)];
+				for (unsigned k = 0; k < 2; k++) {
+					if (!locked[a]) {
+						quadric combined = quadrics[a];
+						combined += quadrics[b];
+						edgeCollapse collapse = {a, b, combined.error(vertices+(b*stride))};
+						collapses.push_back(collapse);
+					}
+					swap(a, b);
+				}
+			}
+		}
+		if (collapses.empty()) break;
+		sort(collapses.begin(), collapses.end(), collapseIsCheaper);
+
+		//Each collapse removes about two triangles. Collapses in one pass must not share triangles, so the flip test
+		//for each sees the mesh as it will be
+		unsigned collapsesWanted = ((indexCount-targetIndexCount)/6)+1, collapseCount = 0;
+		for (unsigned i = 0; i < vertexCount; i++) remap[i] = i;
+		touched.assign(vertexCount, false);
+		for (unsigned i = 0; (i < collapses.size()) && (collapseCount < collapsesWanted); i++) {
+			const edgeCollapse & collapse = collapses[i];
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			bool flips = false;
+			const float * newPosition = vertices+(collapse.to*stride);
+			for (unsigned j = adjacencyStart[collapse.from]; (j < adjacencyStart[collapse.from+1]) && !flips; j++) {
+				const unsigned * triangle = result+(adjacency[j]*3);
+				if ((triangle[0] == collapse.to) || (triangle[1] == collapse.to) || (triangle[2] == collapse.to))
+					continue;
+				const float * corners[3];
+				for (unsigned k = 0; k < 3; k++) corners[k] = vertices+(triangle[k]*stride);
+				vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+				for (unsigned k = 0; k < 3; k++) if (triangle[k] == collapse.from) corners[k] = newPosition;
+				vec3 after = triangleNormal(corners[0], corners[1], corners[2]);
+				float dot = before.dotProduct(after);
+				if (dot <= 0.25f*sqrtf(before.dotProduct(before)*after.dotProduct(after))) flips = true;
+			}
+			if (flips) continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			if (collapse.cost > largestError) largestError = collapse.cost;
+			for (unsigned j = adjacencyStart[collapse.from]; j < adjacencyStart[collapse.from+1]; j++) {
+				for (unsigned k = 0; k < 3; k++) touched[result[(adjacency[j]*3)+k]] = true;
+			}
+			collapseCount++;
+		}
+		if (collapseCount == 0) break;
+
+		unsigned newIndexCount = 0;
+		for (unsigned i = 0; i < indexCount; i += 3) {
+			unsigned a = remap[result[i]], b = remap[result[i+1]], c = remap[result[i+2]];
+			if ((a == b) || (b == c) || (c == a)) continue;
+			result[newIndexCount] = a, result[newIndexCount+1] = b, result[newIndexCount+2] = c;
+			newIndexCount += 3;
+		}
+		indexCount = newIndexCount;
+	}
+
+	if (resultError != NULL) *resultError = float(sqrt(largestError));
+	return indexCount;
+}
+
+static unsigned packSnorm10(float value) {
+	if (value > 1.0f) value = 1.0f; else if (value < -1.0f) value = -1.0f;
+	int packed = int(floorf((value*511.0f)+0.5f));
+	return unsigned(packed) & 0x3ff;
+}
+
+unsigned packNormal(float x, float y, float z) {
+	return packSnorm10(x) | (packSnorm10(y) << 10) | (packSnorm10(z) << 20);
+}
+
+unsigned short packHalf(float value) {
+	unsigned bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned sign = (bits >> 16) & 0x8000, mantissa = bits & 0x7fffff;
+	int exponent = int((bits >> 23) & 0xff);
+	if (exponent == 0xff) return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+	exponent -= 127-15;
+	if (exponent >= 0x1f) return sign | 0x7c00;
+	if (exponent <= 0) {
+		//Denormal, or too small even for that
+		if (exponent < -10) return sign;
+		mantissa |= 0x800000;
+		unsigned shift = 14-exponent;
+		unsigned half = mantissa >> shift, remainder = mantissa & ((1u << shift)-1), halfway = 1u << (shift-1);
+		if ((remainder > halfway) || ((remainder == halfway) && (half & 1))) half++;
+		return sign | half;
+	}
+	unsigned half = (unsigned(exponent) << 10) | (mantissa >> 13), remainder = mantissa & 0x1fff;
+	//Round to nearest even. A carry into the exponent is still correct, up to infinity
+	if ((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1))) half++;
+	return sign | half;
+}
+
+}
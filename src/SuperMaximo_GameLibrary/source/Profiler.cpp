@@ -0,0 +1,220 @@
+//============================================================================
+// Name        : Profiler.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary CPU and GPU frame profiler
+//============================================================================
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+using namespace std;
+
+#include <GL/glew.h>
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+
+namespace SuperMaximo {
+
+//Frames to wait before asking whether a timer query has finished. Results are only read once they are available, so
+//this just saves polling queries the GPU cannot have reached yet
+const unsigned GPU_QUERY_LATENCY = 2;
+
+struct pendingQuery {
+	GLuint query;
+	unsigned long long frameNumber;
+	unsigned eventIndex;
+};
+
+//Read by scopes on any thread without the lock. Enabling publishes the cleared history and epoch along with the flag
+static atomic<bool> profilerEnabled_(false);
+static bool gpuScopeActive = false;
+static chrono::steady_clock::time_point profilerEpoch;
+static mutex profilerMutex;
+static profileFrame profileFrames[PROFILE_FRAME_HISTORY_LENGTH];
+static unsigned long long currentFrameNumber = 0;
+static unsigned recordedFrameCount = 0;
+static vector<GLuint> freeQueries;
+static vector<pendingQuery> pendingQueries;
+static atomic<unsigned short> profilerThreadCount(0);
+static thread_local unsigned short scopeDepth = 0;
+static thread_local int profilerThreadIndex = -1;
+
+static unsigned long long profilerTime() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-profilerEpoch).count();
+}
+
+static profileFrame & currentProfileFrame() {
+	return profileFrames[currentFrameNumber % PROFILE_FRAME_HISTORY_LENGTH];
+}
+
+ProfileScope::ProfileScope(const char * name, bool gpu) : name(name), start(0), query(0),
+		active(profilerEnabled_.load(memory_order_acquire)) {
+	if (!active) return;
+	if (gpu && !gpuScopeActive && gpuProfilingSupported()) {
+		if (freeQueries.empty()) glGenQueries(1, &query); else {
+			query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		gpuScopeActive = true;
+	}
+	scopeDepth++;
+	start = profilerTime();
+}
+
+ProfileScope::~ProfileScope() {
+	if (!active) return;
+	unsigned long long end = profilerTime();
+	scopeDepth--;
+	if (query != 0) {
+		glEndQuery(GL_TIME_ELAPSED);
+		gpuScopeActive = false;
+	}
+	if (profilerThreadIndex < 0) profilerThreadIndex = profilerThreadCount++;
+
+	profileEvent event;
+	event.name = name, event.start = start, event.duration = end-start, event.gpuDuration = -1;
+	event.depth = scopeDepth, event.thread = profilerThreadIndex;
+
+	lock_guard<mutex> lock(profilerMutex);
+	profileFrame & frame = currentProfileFrame();
+	if (query != 0) {
+		pendingQuery pending = {query, frame.number, unsigned(frame.events.size())};
+		pendingQueries.push_back(pending);
+	}
+	frame.events.push_back(event);
+}
+
+void enableProfiler() {
+	if (profilerEnabled_) return;
+	clearProfiler();
+	profilerEnabled_.store(true, memory_order_release);
+}
+
+void disableProfiler() {
+	profilerEnabled_ = false;
+}
+
+bool profilerEnabled() {
+	return profilerEnabled_;
+}
+
+bool gpuProfilingSupported() {
+	static bool supported = (openglVersion() >= 3.3f);
+	return supported;
+}
+
+static void collectGpuTimings() {
+	unsigned remaining = 0;
+	for (unsigned i = 0; i < pendingQueries.size(); i++) {
+		pendingQuery & pending = pendingQueries[i];
+		GLint available = 0;
+		if (pending.frameNumber+GPU_QUERY_LATENCY <= currentFrameNumber) {
+			glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		}
+		if (available) {
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+			profileFrame & frame = profileFrames[pending.frameNumber % PROFILE_FRAME_HISTORY_LENGTH];
+			if (frame.number == pending.frameNumber) frame.events[pending.eventIndex].gpuDuration = nanoseconds;
+			freeQueries.push_back(pending.query);
+		} else pendingQueries[remaining++] = pending;
+	}
+	pendingQueries.resize(remaining);
+}
+
+void endProfilerFrame() {
+	if (!profilerEnabled_) return;
+	lock_guard<mutex> lock(profilerMutex);
+	unsigned long long now = profilerTime();
+	profileFrame & frame = currentProfileFrame();
+	frame.duration = now-frame.start;
+
+	currentFrameNumber++;
+	if (recordedFrameCount < PROFILE_FRAME_HISTORY_LENGTH-1) recordedFrameCount++;
+	profileFrame & nextFrame = currentProfileFrame();
+	nextFrame.number = currentFrameNumber, nextFrame.start = now, nextFrame.duration = 0;
+	nextFrame.events.clear();
+
+	collectGpuTimings();
+}
+
+const profileFrame * getProfileFrame(unsigned framesAgo) {
+	if (framesAgo >= recordedFrameCount) return NULL;
+	return &profileFrames[(currentFrameNumber-1-framesAgo) % PROFILE_FRAME_HISTORY_LENGTH];
+}
+
+unsigned profileFrameCount() {
+	return recordedFrameCount;
+}
+
+void clearProfiler() {
+	lock_guard<mutex> lock(profilerMutex);
+	for (unsigned i = 0; i < pendingQueries.size(); i++) freeQueries.push_back(pendingQueries[i].query);
+	pendingQueries.clear();
+	for (unsigned i = 0; i < PROFILE_FRAME_HISTORY_LENGTH; i++) {
+		profileFrames[i].events.clear();
+		profileFrames[i].number = profileFrames[i].start = profileFrames[i].duration = 0;
+	}
+	currentFrameNumber = 0, recordedFrameCount = 0;
+	profilerEpoch = chrono::steady_clock::now();
+}
+
+static void writeTraceString(ostream & file, const char * str) {
+	file << '"';
+	for (; *str != '\0'; str++) {
+		if ((*str == '"') || (*str == '\\')) file << '\\' << *str;
+		else if ((unsigned char)(*str) < 0x20) file << ' ';
+		else file << *str;
+	}
+	file << '"';
+}
+
+static void writeTraceEvent(ostream & file, const char * name, const char * category, unsigned thread,
+		unsigned long long start, unsigned long long duration) {
+	file << ",\n{\"name\":";
+	writeTraceString(file, name);
+	file << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << start/1000.0
+			<< ",\"dur\":" << duration/1000.0 << "}";
+}
+
+bool writeProfileTrace(const string & fileName) {
+	ofstream file(fileName.c_str(), ios::out | ios::trunc);
+	if (!file.is_open()) {
+		cout << "Could not open " << fileName << " to write the profile trace" << endl;
+		return false;
+	}
+	file.precision(3);
+	file << fixed;
+	//Thread 0 holds the frames, thread 1 the GPU timings and CPU threads follow
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}},\n"
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	lock_guard<mutex> lock(profilerMutex);
+	for (unsigned i = 0; i < profilerThreadCount; i++) {
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i+2 << ",\"args\":{\"name\":\"CPU "
+				<< i << "\"}}";
+	}
+	for (unsigned i = recordedFrameCount; i > 0; i--) {
+		const profileFrame & frame = profileFrames[(currentFrameNumber-i) % PROFILE_FRAME_HISTORY_LENGTH];
+		writeTraceEvent(file, "Frame", "frame", 0, frame.start, frame.duration);
+		for (unsigned j = 0; j < frame.events.size(); j++) {
+			const profileEvent & event = frame.events[j];
+			writeTraceEvent(file, event.name, "cpu", event.thread+2, event.start, event.duration);
+			if (event.gpuDuration >= 0) writeTraceEvent(file, event.name, "gpu", 1, event.start, event.gpuDuration);
+		}
+	}
+	file << "\n]}\n";
+	file.close();
+	return !file.fail();
+}
+
+}
@@ -0,0 +1,210 @@
+//============================================================================
+// Name        : RenderQueue.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary deferred, sorted draw submission
+//============================================================================
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+using namespace std;
+
+#include <GL/glew.h>
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/RenderQueue.h>
+#include <SuperMaximo_GameLibrary/classes/Shader.h>
+
+namespace SuperMaximo {
+
+renderCommand::renderCommand(Shader * shader, GLenum textureTarget, GLuint texture, GLuint vertexArray, GLuint buffer,
+		unsigned vertexCount) : modelview(getMatrix(MODELVIEW_MATRIX)), projection(getMatrix(PROJECTION_MATRIX)),
+		shader(shader), textureTarget(textureTarget), texture(texture), vertexArray(vertexArray), buffer(buffer),
+		materialBuffer(0), ownedTexture(0), ownedBuffer(0), indexType(0), texCoordOffset(0), firstVertex(0),
+		vertexCount(vertexCount), boneOffset(0), boneCount(0), textureCount(-1), bonePaletteOffset(-1),
+		blending(blendingEnabled()), depthTesting(depthTestingEnabled()) {
+	getBlendFunc(&srcBlendFunc, &dstBlendFunc, &blendFuncEquation);
+}
+
+struct sortEntry {
+	unsigned long long key;
+	unsigned index;
+};
+
+static bool renderQueueEnabled_ = false;
+static unsigned char renderLayer_ = 0;
+static vector<renderCommand> commands;
+static vector<sortEntry> sortEntries, sortBuffer;
+static vector<mat4> boneMatrices;
+
+void enableRenderQueue() {
+	renderQueueEnabled_ = true;
+}
+
+void disableRenderQueue() {
+	flushRenderQueue();
+	renderQueueEnabled_ = false;
+}
+
+bool renderQueueEnabled() {
+	return renderQueueEnabled_;
+}
+
+void setRenderLayer(unsigned char layer) {
+	renderLayer_ = layer;
+}
+
+unsigned char renderLayer() {
+	return renderLayer_;
+}
+
+//Maps a float to an unsigned integer with the same ordering
+static unsigned orderedBits(float value) {
+	unsigned bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+//Layer in the top 8 bits, then a bit set for blended commands. Opaque commands follow with 12 bits of shader, 14 of
+//texture, 13 of vertex array and 16 of depth, nearest first. Blended commands follow with 24 bits of depth, furthest
+//first, then 8 bits of blend function, 11 of shader and 12 of texture. Object names are truncated, which only costs
+//some sorting quality if they collide
+static unsigned long long sortKey(const renderCommand & command) {
+	typedef unsigned long long u64;
+	//Eye space z, which is negative in front of the camera
+	unsigned depth = orderedBits(command.modelview.component[14]);
+	u64 program = command.shader != NULL ? GLuint(*command.shader) : 0;
+	u64 key = u64(renderLayer_) << 56;
+	if (command.blending) {
+		u64 blend = ((command.srcBlendFunc*31u)+(command.dstBlendFunc*7u)+command.blendFuncEquation) & 0xff;
+		key |= (u64(1) << 55) | (u64(depth >> 8) << 31) | (blend << 23) | ((program & 0x7ff) << 12) |
+				(command.texture & 0xfff);
+	} else {
+		key |= ((program & 0xfff) << 43) | (u64(command.texture & 0x3fff) << 29) |
+				(u64(command.vertexArray & 0x1fff) << 16) | ((~depth) >> 16);
+	}
+	return key;
+}
+
+void queueRenderCommand(const renderCommand & command, const mat4 * bones, unsigned boneCount) {
+	if (!renderQueueEnabled_) return;
+	sortEntry entry = {sortKey(command), unsigned(commands.size())};
+	sortEntries.push_back(entry);
+	commands.push_back(command);
+	if ((bones != NULL) && (boneCount > 0)) {
+		commands.back().boneOffset = boneMatrices.size();
+		commands.back().boneCount = boneCount;
+		boneMatrices.insert(boneMatrices.end(), bones, bones+boneCount);
+	}
+}
+
+//Stable least significant digit radix sort, a byte at a time. Passes where every key has the same byte are skipped,
+//which is most of them for typical scenes
+static void sortCommands() {
+	unsigned count = sortEntries.size();
+	sortBuffer.resize(count);
+	sortEntry * source = &sortEntries[0], * destination = &sortBuffer[0];
+	for (unsigned shift = 0; shift < 64; shift += 8) {
+		unsigned histogram[256];
+		memset(histogram, 0, sizeof(histogram));
+		for (unsigned i = 0; i < count; i++) histogram[(source[i].key >> shift) & 0xff]++;
+		if (histogram[(source[0].key >> shift) & 0xff] == count) continue;
+
+		unsigned offset = 0;
+		for (unsigned i = 0; i < 256; i++) {
+			unsigned digitCount = histogram[i];
+			histogram[i] = offset;
+			offset += digitCount;
+		}
+		for (unsigned i = 0; i < count; i++) destination[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+		sortEntry * temp = source;
+		source = destination, destination = temp;
+	}
+	if (source != &sortEntries[0]) sortEntries.swap(sortBuffer);
+}
+
+static void submitCommand(renderCommand & command) {
+	if (command.shader == NULL) return;
+	if (command.blending) enableBlending(command.srcBlendFunc, command.dstBlendFunc, command.blendFuncEquation);
+	else disableBlending();
+	if (command.depthTesting) enableDepthTesting(); else disableDepthTesting();
+
+	Shader * shader = command.shader;
+	shader->use();
+	copyMatrix(command.projection, PROJECTION_MATRIX);
+	shader->setUniform16(MODELVIEW_LOCATION, command.modelview);
+	shader->setProjectionUniform();
+	shader->setUniform1(TEXSAMPLER_LOCATION, 0);
+	if (command.textureCount >= 0) shader->setUniform1(TEXCOMPAT_LOCATION, command.textureCount);
+	if (command.boneCount > 0) {
+		shader->setUniform16(EXTRA0_LOCATION, boneMatrices[command.boneOffset], command.boneCount);
+	}
+	if (command.bonePaletteOffset >= 0) shader->setBonePaletteUniforms(command.bonePaletteOffset);
+
+	bindTextureUnit(TEXTURE0);
+	bindTexture(command.textureTarget, command.texture);
+	if (command.materialBuffer != 0) bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BLOCK, command.materialBuffer);
+	if (command.vertexArray != 0) bindVertexArray(command.vertexArray); else {
+		if (vertexArrayObjectSupported()) bindVertexArray(0);
+		bindBuffer(GL_ARRAY_BUFFER, command.buffer);
+		glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
+		glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
+		if (command.texCoordOffset != 0) {
+			glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(command.texCoordOffset));
+			glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+		} else glDisableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	}
+	if (command.indexType != 0) {
+		GLsizeiptr indexSize = (command.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+		glDrawElements(GL_TRIANGLES, command.vertexCount, command.indexType,
+				(const GLvoid*)(command.firstVertex*indexSize));
+	}
+	else glDrawArrays(GL_TRIANGLES, command.firstVertex, command.vertexCount);
+	currentRenderStats().drawCalls++;
+	currentRenderStats().triangles += command.vertexCount/3;
+}
+
+void flushRenderQueue() {
+	if (commands.empty()) return;
+	SM_PROFILE_GPU_SCOPE("flushRenderQueue");
+	sortCommands();
+
+	bool blending = blendingEnabled(), depthTesting = depthTestingEnabled();
+	blendFuncEnum srcBlendFunc, dstBlendFunc;
+	blendFuncEquEnum blendFuncEquation;
+	getBlendFunc(&srcBlendFunc, &dstBlendFunc, &blendFuncEquation);
+	mat4 projection = getMatrix(PROJECTION_MATRIX);
+
+	bool attributeEnabled = false;
+	for (unsigned i = 0; i < sortEntries.size(); i++) {
+		renderCommand & command = commands[sortEntries[i].index];
+		submitCommand(command);
+		if (command.vertexArray == 0) attributeEnabled = true;
+	}
+	if (attributeEnabled) {
+		if (vertexArrayObjectSupported()) bindVertexArray(0);
+		glDisableVertexAttribArray(VERTEX_ATTRIBUTE);
+		glDisableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	}
+	for (unsigned i = 0; i < commands.size(); i++) {
+		if (commands[i].ownedTexture != 0) deleteTexture(commands[i].ownedTexture);
+		if (commands[i].ownedBuffer != 0) deleteBuffer(commands[i].ownedBuffer);
+	}
+
+	if (blending) enableBlending(srcBlendFunc, dstBlendFunc, blendFuncEquation); else disableBlending();
+	if (depthTesting) enableDepthTesting(); else disableDepthTesting();
+	copyMatrix(projection, PROJECTION_MATRIX);
+	commands.clear();
+	sortEntries.clear();
+	boneMatrices.clear();
+}
+
+unsigned renderQueueSize() {
+	return commands.size();
+}
+
+}
@@ -14,8 +14,14 @@
 #include <cstdarg>
 using namespace std;
 
+#include <SuperMaximo_GameLibrary/Maths.h>
 #include <SuperMaximo_GameLibrary/Utils.h>
 
+#if defined(SM_SIMD_SSE) && (defined(__SSE2__) || defined(_M_X64))
+#define SM_SINCOS_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace SuperMaximo {
 
 int numCharInAlphabet(int letter) {
@@ -81,4 +87,64 @@ string & upperCase(string * str) {
 	return *str;
 }
 
+void sinCos(const float * angles, float * sines, float * cosines, unsigned count) {
+	unsigned i = 0;
+#if defined(SM_SINCOS_SSE2)
+	const __m128 toRad = _mm_set1_ps(float(pi/180.0)), ninety = _mm_set1_ps(90.0f), one = _mm_set1_ps(1.0f);
+	const __m128i oneInt = _mm_set1_epi32(1), twoInt = _mm_set1_epi32(2);
+	for (; i+4 <= count; i += 4) {
+		__m128 angle = _mm_loadu_ps(angles+i);
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(1.0f/90.0f)));
+		__m128 x = _mm_mul_ps(_mm_sub_ps(angle, _mm_mul_ps(_mm_cvtepi32_ps(quadrant), ninety)), toRad);
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 s = _mm_add_ps(_mm_set1_ps(-1.0f/5040.0f), _mm_mul_ps(x2, _mm_set1_ps(1.0f/362880.0f)));
+		s = _mm_add_ps(_mm_set1_ps(1.0f/120.0f), _mm_mul_ps(x2, s));
+		s = _mm_add_ps(_mm_set1_ps(-1.0f/6.0f), _mm_mul_ps(x2, s));
+		s = _mm_mul_ps(x, _mm_add_ps(one, _mm_mul_ps(x2, s)));
+		__m128 c = _mm_add_ps(_mm_set1_ps(-1.0f/720.0f), _mm_mul_ps(x2, _mm_set1_ps(1.0f/40320.0f)));
+		c = _mm_add_ps(_mm_set1_ps(1.0f/24.0f), _mm_mul_ps(x2, c));
+		c = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(x2, c));
+		c = _mm_add_ps(one, _mm_mul_ps(x2, c));
+
+		//Odd quadrants swap sine and cosine, then the sign bits come from bit 1 of the quadrant (and quadrant+1)
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, oneInt), oneInt));
+		__m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		__m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+		__m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, twoInt), 30));
+		__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, oneInt), twoInt), 30));
+		_mm_storeu_ps(sines+i, _mm_xor_ps(sine, sineSign));
+		_mm_storeu_ps(cosines+i, _mm_xor_ps(cosine, cosineSign));
+	}
+#elif defined(SM_SIMD_NEON)
+	const float32x4_t half = vdupq_n_f32(0.5f), one = vdupq_n_f32(1.0f);
+	const int32x4_t oneInt = vdupq_n_s32(1), twoInt = vdupq_n_s32(2);
+	for (; i+4 <= count; i += 4) {
+		float32x4_t angle = vld1q_f32(angles+i), scaled = vmulq_n_f32(angle, 1.0f/90.0f);
+		//Round to nearest by adding +/-0.5 before the truncating conversion
+		uint32x4_t negative = vcltq_f32(scaled, vdupq_n_f32(0.0f));
+		int32x4_t quadrant = vcvtq_s32_f32(vaddq_f32(scaled, vbslq_f32(negative, vnegq_f32(half), half)));
+		float32x4_t x = vmulq_n_f32(vmlsq_n_f32(angle, vcvtq_f32_s32(quadrant), 90.0f), float(pi/180.0));
+		float32x4_t x2 = vmulq_f32(x, x);
+
+		float32x4_t s = vmlaq_n_f32(vdupq_n_f32(-1.0f/5040.0f), x2, 1.0f/362880.0f);
+		s = vmlaq_f32(vdupq_n_f32(1.0f/120.0f), x2, s);
+		s = vmlaq_f32(vdupq_n_f32(-1.0f/6.0f), x2, s);
+		s = vmulq_f32(x, vmlaq_f32(one, x2, s));
+		float32x4_t c = vmlaq_n_f32(vdupq_n_f32(-1.0f/720.0f), x2, 1.0f/40320.0f);
+		c = vmlaq_f32(vdupq_n_f32(1.0f/24.0f), x2, c);
+		c = vmlaq_f32(vdupq_n_f32(-0.5f), x2, c);
+		c = vmlaq_f32(one, x2, c);
+
+		uint32x4_t swap = vceqq_s32(vandq_s32(quadrant, oneInt), oneInt);
+		uint32x4_t sineSign = vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(quadrant, twoInt)), 30);
+		uint32x4_t cosineSign = vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(vaddq_s32(quadrant, oneInt), twoInt)), 30);
+		vst1q_f32(sines+i, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, c, s)), sineSign)));
+		vst1q_f32(cosines+i, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, s, c)),
+				cosineSign)));
+	}
+#endif
+	for (; i < count; i++) sinCos(angles[i], sines+i, cosines+i);
+}
+
 }
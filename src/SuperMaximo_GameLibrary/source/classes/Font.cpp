@@ -14,8 +14,11 @@ using namespace std;
 #include <SDL/SDL_ttf.h>
 #include "../../headers/classes/Font.h"
 #include "../../headers/classes/Shader.h"
+#include "../../headers/classes/StreamBuffer.h"
 #include "../../headers/Display.h"
 #include "../../headers/Utils.h"
+#include "../../headers/Profiler.h"
+#include "../../headers/RenderQueue.h"
 using namespace SuperMaximo;
 
 struct fontCacheRecord {
@@ -27,11 +30,14 @@ struct fontCacheRecord {
 
 vector<fontCacheRecord> fontCache[27];
 Shader * fontShader = NULL;
-GLuint vbo = 0;
+//Quads for text that is not cached, made when it is first needed
+StreamBuffer * fontStreamBuffer = NULL;
+const unsigned FONT_STREAM_QUADS = 256;
 
 namespace SuperMaximo {
 
 Font::Font(const string & newName, const string & fileName, unsigned newSize) {
+	SM_PROFILE_SCOPE("Font::Font");
 	name_ = newName;
 	size = newSize;
 	font = TTF_OpenFont(fileName.c_str(), size);
@@ -47,6 +53,7 @@ string Font::name() {
 
 void Font::write(const string & text, int x, int y, float depth, bool useCache, float rotation, float xScale,
 		float yScale) {
+	SM_PROFILE_SCOPE("Font::write");
 	bool cacheSuccess = false;
 	unsigned cacheIndex = 1;
 	int letter = numCharInAlphabet(text[0]);
@@ -83,16 +90,32 @@ void Font::write(const string & text, int x, int y, float depth, bool useCache,
 		w = textSurface->w;
 		h = textSurface->h;
 	}
+	//Written before anything is bound, as filling a region of the stream buffer flushes the render queue
+	unsigned firstVertex = 0;
+	if (!cacheSuccess) {
+		GLfloat vertexArray[] = {
+			0.0f, h, 0.0f, 1.0f,
+			0.0f, 0.0f, 0.0f, 1.0f,
+			w, 0.0f, 0.0f, 1.0f,
+
+			0.0f, h, 0.0f, 1.0f,
+			w, h, 0.0f, 1.0f,
+			w, 0.0f, 0.0f, 1.0f};
+		if (fontStreamBuffer == NULL) fontStreamBuffer = new StreamBuffer(sizeof(vertexArray)*FONT_STREAM_QUADS);
+		firstVertex = fontStreamBuffer->write(vertexArray, sizeof(vertexArray), 4*sizeof(GLfloat))/(4*sizeof(GLfloat));
+	}
 	GLenum textureFormat, textureType;
 	if (textureRectangleEnabled()) textureType = GL_TEXTURE_RECTANGLE; else textureType = GL_TEXTURE_2D;
 	GLuint tempTexture;
-	glActiveTexture(GL_TEXTURE0);
+	bindTextureUnit(TEXTURE0);
+	//The attribute pointer set below must not land in whichever vertex array was last bound
+	if (vertexArrayObjectSupported()) bindVertexArray(0);
 
 	if (cacheSuccess) {
-		glBindTexture(textureType, fontCache[letter][cacheIndex].texture);
+		bindTexture(textureType, fontCache[letter][cacheIndex].texture);
 		w = fontCache[letter][cacheIndex].w;
 		h = fontCache[letter][cacheIndex].h;
-		glBindBuffer(GL_ARRAY_BUFFER, fontCache[letter][cacheIndex].vbo);
+		bindBuffer(GL_ARRAY_BUFFER, fontCache[letter][cacheIndex].vbo);
 		glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
 	} else {
 		if (textSurface->format->BytesPerPixel == 4) {
@@ -101,46 +124,49 @@ void Font::write(const string & text, int x, int y, float depth, bool useCache,
 			if (textSurface->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
 		}
 		glGenTextures(1, &tempTexture);
-		glBindTexture(textureType, tempTexture);
+		bindTexture(textureType, tempTexture);
 		glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexImage2D(textureType, 0, textSurface->format->BytesPerPixel, w, h, 0, textureFormat, GL_UNSIGNED_BYTE,
 				textSurface->pixels);
+		currentRenderStats().bytesUploaded += w*h*textSurface->format->BytesPerPixel;
 
-		GLfloat vertexArray[] = {
-			0.0f, h, 0.0f, 1.0f,
-			0.0f, 0.0f, 0.0f, 1.0f,
-			w, 0.0f, 0.0f, 1.0f,
-
-			0.0f, h, 0.0f, 1.0f,
-			w, h, 0.0f, 1.0f,
-			w, 0.0f, 0.0f, 1.0f};
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertexArray), vertexArray, GL_STATIC_DRAW);
+		bindBuffer(GL_ARRAY_BUFFER, fontStreamBuffer->buffer());
 		glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
 	}
 	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
 
-	glUseProgram(fontShader->program_);
 	pushMatrix();
-		translateMatrix(x, y, depth);
-		rotateMatrix(rotation, 0.0f, 0.0f, 1.0f);
-		scaleMatrix(xScale, yScale, 0.0f);
+		transformMatrix(vec3(x, y, depth), vec3(0.0f, 0.0f, rotation), vec3(xScale, yScale, 0.0f));
+		if (renderQueueEnabled()) {
+			renderCommand command(fontShader, textureType, cacheSuccess ? fontCache[letter][cacheIndex].texture :
+					tempTexture, 0, cacheSuccess ? fontCache[letter][cacheIndex].vbo : fontStreamBuffer->buffer(), 6);
+			//Text that is not cached is drawn from a temporary texture, which the queue deletes after drawing it
+			if (!cacheSuccess) {
+				command.ownedTexture = tempTexture, command.firstVertex = firstVertex;
+				SDL_FreeSurface(textSurface);
+			}
+			queueRenderCommand(command);
+			glDisableVertexAttribArray(VERTEX_ATTRIBUTE);
+			popMatrix();
+			return;
+		}
+
+		bindProgram(fontShader->program_);
 
 		fontShader->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
-		fontShader->setUniform16(PROJECTION_LOCATION, getMatrix(PROJECTION_MATRIX));
+		fontShader->setProjectionUniform();
 		fontShader->setUniform1(TEXSAMPLER_LOCATION, 0);
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDrawArrays(GL_TRIANGLES, firstVertex, 6);
 		glDisableVertexAttribArray(VERTEX_ATTRIBUTE);
 	popMatrix();
+	currentRenderStats().drawCalls++;
+	currentRenderStats().triangles += 2;
 
 	if (!cacheSuccess) {
 		SDL_FreeSurface(textSurface);
-		glDeleteTextures(1, &tempTexture);
-		glDeleteBuffers(1, &vbo);
+		deleteTexture(tempTexture);
 	}
 }
 
@@ -188,11 +214,12 @@ void Font::cache(const string & text) {
 	if (textureRectangleEnabled()) textureType = GL_TEXTURE_RECTANGLE; else textureType = GL_TEXTURE_2D;
 
 	glGenTextures(1, &newRecord.texture);
-	glBindTexture(textureType, newRecord.texture);
+	bindTexture(textureType, newRecord.texture);
 	glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexImage2D(textureType, 0, textSurface->format->BytesPerPixel, textSurface->w, textSurface->h, 0, textureFormat,
 			GL_UNSIGNED_BYTE, textSurface->pixels);
+	currentRenderStats().bytesUploaded += textSurface->w*textSurface->h*textSurface->format->BytesPerPixel;
 
 	GLfloat vertexArray[] = {
 		0.0f, textSurface->h, 0.0f, 1.0f,
@@ -205,20 +232,22 @@ void Font::cache(const string & text) {
 	SDL_FreeSurface(textSurface);
 
 	glGenBuffers(1, &newRecord.vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, newRecord.vbo);
+	bindBuffer(GL_ARRAY_BUFFER, newRecord.vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexArray), vertexArray, GL_STATIC_DRAW);
 	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	currentRenderStats().bytesUploaded += sizeof(vertexArray);
 
 	fontCache[letter].push_back(newRecord);
 }
 
 void Font::removeFromCache(const string & text) {
+	flushRenderQueue();
 	int letter = numCharInAlphabet(text[0]);
 	if (fontCache[letter].size() > 0) {
 		for (unsigned int i = 0; i < fontCache[letter].size(); i++) {
 			if ((fontCache[letter][i].text == text) && (fontCache[letter][i].fontName == name_)) {
-				glDeleteTextures(1, &fontCache[letter][i].texture);
-				glDeleteBuffers(1, &fontCache[letter][i].vbo);
+				deleteTexture(fontCache[letter][i].texture);
+				deleteBuffer(fontCache[letter][i].vbo);
 				fontCache[letter].erase(fontCache[letter].begin()+i);
 				break;
 			}
@@ -235,18 +264,40 @@ void quitFont() {
 	TTF_Quit();
 	fontShader = NULL;
 	clearFontCache();
+	delete fontStreamBuffer;
+	fontStreamBuffer = NULL;
 }
 
 void bindFontShader(Shader * newFontShader) {
 	fontShader = newFontShader;
 }
 
+void writeRenderStats(Font * font, int x, int y, float depth) {
+	if ((font == NULL) || (fontShader == NULL)) return;
+	renderStats stats = getRenderStats();
+	frameTimeStats frameTimes = getFrameTimeStats();
+	string lines[4] = {
+		"Draws "+toString(stats.drawCalls)+"  Triangles "+toString(stats.triangles)+"  Culled "+
+				toString(stats.objectsCulled),
+		"Programs "+toString(stats.programSwitches)+"  Textures "+toString(stats.textureBinds)+"  VAOs "+
+				toString(stats.vertexArrayBinds)+"  Buffers "+toString(stats.bufferBinds),
+		"Uniforms "+toString(stats.uniformUploads)+"  Uploaded "+toString(stats.bytesUploaded/1024)+" KB",
+		"Frame ms "+toString(getFrameTime())+"  p50 "+toString(frameTimes.p50)+"  p95 "+toString(frameTimes.p95)+
+				"  p99 "+toString(frameTimes.p99)
+	};
+	for (short i = 0; i < 4; i++) {
+		font->write(lines[i], x, y, depth, false);
+		y += font->height(lines[i]);
+	}
+}
+
 void clearFontCache() {
+	flushRenderQueue();
 	for (int i = 0; i < 27; i++) {
 		if (fontCache[i].size() > 0) {
 			for (unsigned int j = 0; j < fontCache[i].size(); j++) {
-				glDeleteTextures(1, &fontCache[i][j].texture);
-				glDeleteBuffers(1, &fontCache[i][j].vbo);
+				deleteTexture(fontCache[i][j].texture);
+				deleteBuffer(fontCache[i][j].vbo);
 			}
 			fontCache[i].clear();
 		}
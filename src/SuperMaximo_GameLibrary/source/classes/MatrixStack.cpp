@@ -0,0 +1,196 @@
+//============================================================================
+// Name        : MatrixStack.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary MatrixStack class
+//============================================================================
+
+#include <cmath>
+using namespace std;
+
+#include <SuperMaximo_GameLibrary/Utils.h>
+#include <SuperMaximo_GameLibrary/classes/MatrixStack.h>
+
+namespace SuperMaximo {
+
+static const unsigned cacheLineSize = 64;
+
+static char * allocateMatrices(unsigned capacity, mat4 ** matrix, mat4 ** stack) {
+	unsigned matrixCount = MATRIX_STACK_COUNT+1+(capacity*MATRIX_STACK_COUNT);
+	char * memory = new char[(matrixCount*sizeof(mat4))+cacheLineSize];
+	size_t offset = (cacheLineSize-(size_t(memory) % cacheLineSize)) % cacheLineSize;
+	*matrix = (mat4 *)(memory+offset);
+	*stack = *matrix+MATRIX_STACK_COUNT+1;
+	return memory;
+}
+
+MatrixStack::MatrixStack(unsigned capacity) : capacity_(capacity > 0 ? capacity : 1),
+		currentMatrixId(MODELVIEW_MATRIX) {
+	memory = allocateMatrices(capacity_, &matrix_, &stack_);
+	for (short i = 0; i <= MATRIX_STACK_COUNT; i++) matrix_[i].initIdentity();
+	for (short i = 0; i < MATRIX_STACK_COUNT; i++) depth_[i] = 0;
+}
+
+MatrixStack::~MatrixStack() {
+	delete[] memory;
+}
+
+void MatrixStack::setCurrent(matrixEnum matrixId) {
+	if (matrixId != IDENTITY_MATRIX) currentMatrixId = matrixId;
+}
+
+matrixEnum MatrixStack::current() const {
+	return currentMatrixId;
+}
+
+void MatrixStack::copy(matrixEnum srcMatrixId, matrixEnum dstMatrixId) {
+	if (dstMatrixId == IDENTITY_MATRIX) return;
+	matrix_[dstMatrixId] = matrix_[srcMatrixId];
+}
+
+void MatrixStack::copy(const mat4 & srcMatrix, matrixEnum dstMatrixId) {
+	if (dstMatrixId == IDENTITY_MATRIX) return;
+	matrix_[dstMatrixId] = srcMatrix;
+}
+
+const mat4 & MatrixStack::get(matrixEnum matrixId) const {
+	return matrix_[matrixId];
+}
+
+void MatrixStack::push() {
+	unsigned & depth = depth_[currentMatrixId];
+	if (depth == capacity_) reserve(capacity_*2);
+	stack_[(currentMatrixId*capacity_)+depth] = matrix_[currentMatrixId];
+	depth++;
+}
+
+void MatrixStack::pop() {
+	unsigned & depth = depth_[currentMatrixId];
+	if (depth == 0) return;
+	depth--;
+	matrix_[currentMatrixId] = stack_[(currentMatrixId*capacity_)+depth];
+}
+
+unsigned MatrixStack::depth(matrixEnum matrixId) const {
+	return matrixId < MATRIX_STACK_COUNT ? depth_[matrixId] : 0;
+}
+
+unsigned MatrixStack::capacity() const {
+	return capacity_;
+}
+
+void MatrixStack::reserve(unsigned capacity) {
+	if (capacity <= capacity_) return;
+	mat4 * matrix, * stack;
+	char * newMemory = allocateMatrices(capacity, &matrix, &stack);
+	for (short i = 0; i <= MATRIX_STACK_COUNT; i++) matrix[i] = matrix_[i];
+	for (short i = 0; i < MATRIX_STACK_COUNT; i++) {
+		for (unsigned j = 0; j < depth_[i]; j++) stack[(i*capacity)+j] = stack_[(i*capacity_)+j];
+	}
+	delete[] memory;
+	memory = newMemory, matrix_ = matrix, stack_ = stack, capacity_ = capacity;
+}
+
+//The transformation functions below work on the columns of the current matrix in place. Translations, scales and
+//axis rotations only mix a few columns so there is no need for a full 4x4 multiply
+static inline void addScaledColumns(float * dst, const float * a, float aScale, const float * b, float bScale) {
+	for (short i = 0; i < 4; i++) dst[i] = (a[i]*aScale)+(b[i]*bScale);
+}
+
+static void rotateColumns(float * a, float * b, float c, float s) {
+	float column[4];
+	addScaledColumns(column, a, c, b, s);
+	addScaledColumns(b, b, c, a, -s);
+	for (short i = 0; i < 4; i++) a[i] = column[i];
+}
+
+void MatrixStack::translate(float x, float y, float z) {
+	float * m = matrix_[currentMatrixId].component;
+	for (short i = 0; i < 4; i++) m[12+i] += (m[i]*x)+(m[4+i]*y)+(m[8+i]*z);
+}
+
+void MatrixStack::rotate(float angle, float x, float y, float z) {
+	if ((y == 0.0f) && (z == 0.0f) && (x != 0.0f)) {
+		rotate(x > 0.0f ? angle : -angle, X_AXIS);
+		return;
+	} else if ((x == 0.0f) && (z == 0.0f) && (y != 0.0f)) {
+		rotate(y > 0.0f ? angle : -angle, Y_AXIS);
+		return;
+	} else if ((x == 0.0f) && (y == 0.0f) && (z != 0.0f)) {
+		rotate(z > 0.0f ? angle : -angle, Z_AXIS);
+		return;
+	}
+
+	float len = sqrt((x*x)+(y*y)+(z*z));
+	x /= len;
+	y /= len;
+	z /= len;
+	mat4 transformationMatrix;
+
+	float c, s, x2 = x*x, y2 = y*y, z2 = z*z;
+	sinCos(angle, &s, &c);
+	float t = 1.0f-c;
+
+	transformationMatrix.component[0] = (x2*t)+c;
+	transformationMatrix.component[1] = (y*x*t)+z*s;
+	transformationMatrix.component[2] = (x*z*t)-(y*s);
+	transformationMatrix.component[3] = 0.0f;
+
+	transformationMatrix.component[4] = (x*y*t)-(z*s);
+	transformationMatrix.component[5] = (y2*t)+c;
+	transformationMatrix.component[6] = (y*z*t)+(x*s);
+	transformationMatrix.component[7] = 0.0f;
+
+	transformationMatrix.component[8] = (x*z*t)+(y*s);
+	transformationMatrix.component[9] = (y*z*t)-(x*s);
+	transformationMatrix.component[10] = (z2*t)+c;
+	transformationMatrix.component[11] = 0.0f;
+
+	transformationMatrix.component[12] = 0.0f;
+	transformationMatrix.component[13] = 0.0f;
+	transformationMatrix.component[14] = 0.0f;
+	transformationMatrix.component[15] = 1.0f;
+
+	multiply(transformationMatrix);
+}
+
+void MatrixStack::rotate(float angle, axisEnum axis) {
+	float c, s;
+	sinCos(angle, &s, &c);
+	float * m = matrix_[currentMatrixId].component;
+	switch (axis) {
+	case X_AXIS: rotateColumns(m+4, m+8, c, s); break;
+	case Y_AXIS: rotateColumns(m+8, m, c, s); break;
+	case Z_AXIS: rotateColumns(m, m+4, c, s); break;
+	}
+}
+
+void MatrixStack::scale(float xScale, float yScale, float zScale) {
+	float * m = matrix_[currentMatrixId].component;
+	for (short i = 0; i < 4; i++) {
+		m[i] *= xScale;
+		m[4+i] *= yScale;
+		m[8+i] *= zScale;
+	}
+}
+
+void MatrixStack::transform(const vec3 & position, const vec3 & rotation, const vec3 & scale) {
+	const mat4 transformationMatrix = getTransformationMatrix(position, rotation, scale);
+	const float * t = transformationMatrix.component;
+	float * m = matrix_[currentMatrixId].component;
+	float result[16];
+	//The bottom row of the transformation matrix is always (0, 0, 0, 1)
+	for (short i = 0; i < 16; i += 4) {
+		for (short j = 0; j < 4; j++) result[i+j] = (m[j]*t[i])+(m[4+j]*t[i+1])+(m[8+j]*t[i+2]);
+	}
+	for (short j = 0; j < 4; j++) result[12+j] += m[12+j];
+	for (short i = 0; i < 16; i++) m[i] = result[i];
+}
+
+void MatrixStack::multiply(const mat4 & otherMatrix) {
+	matrix_[currentMatrixId] = matrix_[currentMatrixId]*otherMatrix;
+}
+
+}
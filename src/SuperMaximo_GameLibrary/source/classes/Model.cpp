@@ -11,6 +11,7 @@
 #include <fstream>
 #include <vector>
 #include <cmath>
+#include <cstring>
 using namespace std;
 
 #include <GL/glew.h>
@@ -21,6 +22,9 @@ using namespace std;
 #include "../../headers/classes/Shader.h"
 #include "../../headers/Display.h"
 #include "../../headers/Utils.h"
+#include "../../headers/Mesh.h"
+#include "../../headers/Profiler.h"
+#include "../../headers/RenderQueue.h"
 using namespace SuperMaximo;
 
 struct vertexNormalAssoication {
@@ -56,11 +60,241 @@ vec3 Model::triangle::surfaceNormal() {
 	return normal_;
 }
 
+//The 24 byte vertex used with compact vertices, and one material of its uniform block in std140 layout
+struct compactVertex {
+	GLfloat x, y, z;
+	GLuint normal;
+	GLushort s, t, material;
+	GLshort bone;
+};
+
+struct materialBlockEntry {
+	GLfloat ambient[4], diffuse[4], specular[4];
+};
+
+inline void setupVertexAttribs() {
+	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24, 0);
+	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*4));
+	glVertexAttribPointer(COLOR0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*7));
+	glVertexAttribPointer(COLOR1_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*10));
+	glVertexAttribPointer(COLOR2_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*13));
+	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*16));
+	glVertexAttribPointer(EXTRA0_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*19));
+	glVertexAttribPointer(EXTRA1_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*20));
+	glVertexAttribPointer(EXTRA2_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*21));
+	glVertexAttribPointer(EXTRA3_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*22));
+	glVertexAttribPointer(EXTRA4_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
+			(const GLvoid*)(sizeof(GLfloat)*23));
+
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
+	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+	glEnableVertexAttribArray(COLOR0_ATTRIBUTE);
+	glEnableVertexAttribArray(COLOR1_ATTRIBUTE);
+	glEnableVertexAttribArray(COLOR2_ATTRIBUTE);
+	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA0_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA1_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA2_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA3_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA4_ATTRIBUTE);
+}
+
+inline void setupCompactVertexAttribs() {
+	glVertexAttribPointer(VERTEX_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(compactVertex), 0);
+	glVertexAttribPointer(NORMAL_ATTRIBUTE, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(compactVertex),
+			(const GLvoid*)(sizeof(GLfloat)*3));
+	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(compactVertex),
+			(const GLvoid*)(sizeof(GLfloat)*4));
+	glVertexAttribPointer(EXTRA0_ATTRIBUTE, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(compactVertex),
+			(const GLvoid*)(sizeof(GLfloat)*5));
+	glVertexAttribPointer(EXTRA4_ATTRIBUTE, 1, GL_SHORT, GL_FALSE, sizeof(compactVertex),
+			(const GLvoid*)((sizeof(GLfloat)*5)+sizeof(GLushort)));
+
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
+	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+	glDisableVertexAttribArray(COLOR0_ATTRIBUTE);
+	glDisableVertexAttribArray(COLOR1_ATTRIBUTE);
+	glDisableVertexAttribArray(COLOR2_ATTRIBUTE);
+	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA0_ATTRIBUTE);
+	glDisableVertexAttribArray(EXTRA1_ATTRIBUTE);
+	glDisableVertexAttribArray(EXTRA2_ATTRIBUTE);
+	glDisableVertexAttribArray(EXTRA3_ATTRIBUTE);
+	glEnableVertexAttribArray(EXTRA4_ATTRIBUTE);
+}
+
+//Packs 24 float vertices into compactVertex, moving the material values into a uniform buffer. Returns false, having
+//uploaded nothing, if there are too many materials
+bool Model::uploadCompactVertices(const vector<GLfloat> & vertices, bufferUsageEnum bufferUsage) {
+	unsigned vertexCount = vertices.size()/24;
+	if (vertexCount == 0) return false;
+	vector<materialBlockEntry> materialBlock;
+	vector<compactVertex> packedVertices(vertexCount);
+	unsigned lastMaterial = 0;
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const GLfloat * vertex = &vertices[i*24];
+		materialBlockEntry entry;
+		for (unsigned j = 0; j < 3; j++) {
+			entry.ambient[j] = vertex[7+j], entry.diffuse[j] = vertex[10+j], entry.specular[j] = vertex[13+j];
+		}
+		entry.ambient[3] = (vertex[20] != 0.0f) ? vertex[19] : -1.0f;
+		entry.diffuse[3] = vertex[22], entry.specular[3] = vertex[21];
+
+		//Vertices of one material tend to come together, so try the last one first
+		if ((materialBlock.empty()) || (memcmp(&entry, &materialBlock[lastMaterial], sizeof(entry)) != 0)) {
+			lastMaterial = 0;
+			while ((lastMaterial < materialBlock.size())
+					&& (memcmp(&entry, &materialBlock[lastMaterial], sizeof(entry)) != 0)) lastMaterial++;
+			if (lastMaterial == materialBlock.size()) {
+				if (materialBlock.size() == MODEL_MAX_MATERIALS) {
+					cout << "Model " << name_ << " has more than " << MODEL_MAX_MATERIALS
+							<< " materials, so it will use full size vertices" << endl;
+					return false;
+				}
+				materialBlock.push_back(entry);
+			}
+		}
+
+		compactVertex & packed = packedVertices[i];
+		packed.x = vertex[0], packed.y = vertex[1], packed.z = vertex[2];
+		packed.normal = packNormal(vertex[4], vertex[5], vertex[6]);
+		packed.s = packHalf(vertex[16]), packed.t = packHalf(vertex[17]);
+		packed.material = lastMaterial;
+		packed.bone = GLshort(vertex[23]);
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, sizeof(compactVertex)*vertexCount, &packedVertices[0], bufferUsage);
+	currentRenderStats().bytesUploaded += sizeof(compactVertex)*vertexCount;
+
+	glGenBuffers(1, &materialUbo);
+	bindBuffer(GL_UNIFORM_BUFFER, materialUbo);
+	//The buffer bound to a block must be at least as big as the block, so size it for every material
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(materialBlockEntry)*MODEL_MAX_MATERIALS, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(materialBlockEntry)*materialBlock.size(), &materialBlock[0]);
+	currentRenderStats().bytesUploaded += sizeof(materialBlockEntry)*materialBlock.size();
+	return true;
+}
+
+//Merges duplicate vertices and reorders the triangles for the post-transform cache, then for overdraw, then renumbers
+//the vertices in the order they are used, before uploading them with an index buffer holding every level of detail
+void Model::uploadVertexArray(GLfloat * vertexArray, bufferUsageEnum bufferUsage) {
+	SM_PROFILE_SCOPE("Model::uploadVertexArray");
+	vector<GLfloat> uniqueVertices;
+	vector<unsigned> indices;
+	unsigned uniqueCount = indexVertices(vertexArray, vertexCount_, 24, &uniqueVertices, &indices);
+	if (uniqueCount > 0) {
+		optimiseVertexCache(&indices[0], indices.size(), uniqueCount);
+		optimiseOverdraw(&indices[0], indices.size(), &uniqueVertices[0], uniqueCount, 24);
+		optimiseVertexFetch(&indices[0], indices.size(), &uniqueVertices[0], uniqueCount, 24);
+	}
+
+	glGenBuffers(1, &vbo);
+	bindBuffer(GL_ARRAY_BUFFER, vbo);
+	if (compactVerticesEnabled() && uploadCompactVertices(uniqueVertices, bufferUsage)) setupCompactVertexAttribs();
+	else {
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*uniqueVertices.size(),
+				uniqueCount > 0 ? &uniqueVertices[0] : NULL, bufferUsage);
+		currentRenderStats().bytesUploaded += sizeof(GLfloat)*uniqueVertices.size();
+		setupVertexAttribs();
+	}
+
+	//Simpler levels of detail follow the full index list in the same buffer. Each is simplified from the one before,
+	//which is quicker than starting from the full mesh every time, so their errors add up
+	lods_.clear();
+	lodLevel fullLevel = {0, unsigned(indices.size()), 0.0f};
+	lods_.push_back(fullLevel);
+	if (indices.size()/3 >= MODEL_LOD_MIN_TRIANGLES) {
+		vector<unsigned> previousIndices(indices), lodIndices(indices.size());
+		for (unsigned i = 1; i < MODEL_MAX_LODS; i++) {
+			const lodLevel & previous = lods_.back();
+			unsigned target = previous.indexCount/2;
+			target -= target%3;
+			lodLevel level = {unsigned(indices.size()), 0, 0.0f};
+			level.indexCount = simplifyMesh(&previousIndices[0], previous.indexCount, &uniqueVertices[0], uniqueCount,
+					24, target, &lodIndices[0], &level.error);
+			//Stop once simplifying stops paying for the extra indices
+			if (level.indexCount > (previous.indexCount*3)/4) break;
+			level.error += previous.error;
+			optimiseVertexCache(&lodIndices[0], level.indexCount, uniqueCount);
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin()+level.indexCount);
+			previousIndices.assign(lodIndices.begin(), lodIndices.begin()+level.indexCount);
+			lods_.push_back(level);
+		}
+	}
+
+	//Occluders use the full detail triangles, as simplified ones can cover gaps in the real model. Skeletal animation is
+	//ignored, so occluders stay in their rest pose
+	const lodLevel & full = lods_.front();
+	vector<unsigned> occluderRemap(uniqueCount, ~0u);
+	occluderVertices_.clear(), occluderIndices_.clear();
+	occluderIndices_.reserve(full.indexCount);
+	for (unsigned i = full.firstIndex; i < full.firstIndex+full.indexCount; i++) {
+		unsigned index = indices[i];
+		if (occluderRemap[index] == ~0u) {
+			occluderRemap[index] = occluderVertices_.size()/3;
+			occluderVertices_.insert(occluderVertices_.end(), &uniqueVertices[index*24], &uniqueVertices[index*24]+3);
+		}
+		occluderIndices_.push_back(occluderRemap[index]);
+	}
+
+	glGenBuffers(1, &ibo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	if (uniqueCount <= 65536) {
+		vector<GLushort> shortIndices(indices.begin(), indices.end());
+		indexType = GL_UNSIGNED_SHORT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort)*shortIndices.size(),
+				shortIndices.empty() ? NULL : &shortIndices[0], GL_STATIC_DRAW);
+		currentRenderStats().bytesUploaded += sizeof(GLushort)*shortIndices.size();
+	} else {
+		indexType = GL_UNSIGNED_INT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*indices.size(), &indices[0], GL_STATIC_DRAW);
+		currentRenderStats().bytesUploaded += sizeof(GLuint)*indices.size();
+	}
+	//Without a vertex array object to hold it, the element buffer is bound again for each draw
+	if (!vertexArrayObjectSupported()) bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+//A sphere around the centre of the box is not the smallest, but is close for most models and cheap to find
+void Model::calculateBounds(const GLfloat * vertices, unsigned vertexCount, unsigned stride) {
+	vec3 minimum(vertices[0], vertices[1], vertices[2]), maximum = minimum;
+	for (unsigned i = 1; i < vertexCount; i++) {
+		const GLfloat * vertex = vertices+(i*stride);
+		if (vertex[0] < minimum.x) minimum.x = vertex[0]; else if (vertex[0] > maximum.x) maximum.x = vertex[0];
+		if (vertex[1] < minimum.y) minimum.y = vertex[1]; else if (vertex[1] > maximum.y) maximum.y = vertex[1];
+		if (vertex[2] < minimum.z) minimum.z = vertex[2]; else if (vertex[2] > maximum.z) maximum.z = vertex[2];
+	}
+	bounds_.minimum = minimum, bounds_.maximum = maximum;
+
+	vec3 centre = (minimum+maximum)*0.5f;
+	float radiusSquared = 0.0f;
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const GLfloat * vertex = vertices+(i*stride);
+		vec3 offset = vec3(vertex[0], vertex[1], vertex[2])-centre;
+		float distanceSquared = offset.dotProduct(offset);
+		if (distanceSquared > radiusSquared) radiusSquared = distanceSquared;
+	}
+	sphereBounds_.centre = centre;
+	sphereBounds_.radius = sqrt(radiusSquared);
+}
+
 Model::Model(const string & newName, const string & path, const string & fileName, unsigned framerate,
 		bufferUsageEnum bufferUsage, void (*customBufferFunction)(GLuint*, Model*, void*), void * customData) {
 	name_ = newName;
 	boundShader_ = NULL;
 	framerate_ = framerate;
+	ibo = 0, indexType = 0;
+	instanceVbo = 0, instanceCapacity = 0;
+	materialUbo = 0;
+	sphereBounds_.radius = 0.0f;
 	if (lowerCase(leftStr(rightStr(fileName, 3), 2)) == "sm") {
 		switch (rightStr(fileName, 1)[0]) {
 		case 'o': loadSmo(path, fileName, bufferUsage); break;
@@ -71,14 +305,19 @@ Model::Model(const string & newName, const string & path, const string & fileNam
 }
 
 Model::~Model() {
-	glDeleteTextures(1, &texture);
+	flushRenderQueue();
+	deleteTexture(texture);
 	for (unsigned i = 0; i < bones_.size(); i++) delete bones_[i];
-	glDeleteBuffers(1, &vbo);
-	if (vertexArrayObjectSupported()) glDeleteVertexArrays(1, &vao);
+	deleteBuffer(vbo);
+	if (ibo != 0) deleteBuffer(ibo);
+	if (instanceVbo != 0) deleteBuffer(instanceVbo);
+	if (materialUbo != 0) deleteBuffer(materialUbo);
+	if (vertexArrayObjectSupported()) deleteVertexArray(vao);
 }
 
 void Model::loadObj(const string & path, const string & fileName, bufferUsageEnum bufferUsage,
 		void (*customBufferFunction)(GLuint*, Model*, void*), void * customData) {
+	SM_PROFILE_SCOPE("Model::loadObj");
 	vector<string> objText, mtlText;
 	vector<vertex> vertices, texCoord;
 	ifstream file;
@@ -241,7 +480,7 @@ void Model::loadObj(const string & path, const string & fileName, bufferUsageEnu
 						initialised = true;
 						glGenTextures(1, &texture);
 						if (texture2dArrayDisabled()) {
-							glBindTexture(GL_TEXTURE_2D, texture);
+							bindTexture(GL_TEXTURE_2D, texture);
 							glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 							glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 							if (openglVersion() >= 3.0f) glGenerateMipmap(GL_TEXTURE_2D);
@@ -250,7 +489,7 @@ void Model::loadObj(const string & path, const string & fileName, bufferUsageEnu
 							glTexImage2D(GL_TEXTURE_2D, 0, image->format->BytesPerPixel, image->w*totalMaterials,
 									image->h, 0, textureFormat, GL_UNSIGNED_BYTE, NULL);
 						} else {
-							glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+							bindTexture(GL_TEXTURE_2D_ARRAY, texture);
 							glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 							glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 							if (openglVersion() >= 3.0f) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
@@ -266,6 +505,7 @@ void Model::loadObj(const string & path, const string & fileName, bufferUsageEnu
 								GL_UNSIGNED_BYTE, image->pixels);
 					else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, materials_.size(), image->w, image->h, 1,
 							textureFormat, GL_UNSIGNED_BYTE, image->pixels);
+					currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 					SDL_FreeSurface(image);
 					newMaterial.hasTexture = true;
 				}
@@ -435,16 +675,28 @@ void Model::loadObj(const string & path, const string & fileName, bufferUsageEnu
 	}
 	vertexCount_ = triangles_.size()*3;
 
+	vector<GLfloat> positions;
+	positions.reserve(vertexCount_*3);
+	for (unsigned i = 0; i < triangles_.size(); i++) {
+		for (short j = 0; j < 3; j++) {
+			positions.push_back(triangles_[i].coords[j].x);
+			positions.push_back(triangles_[i].coords[j].y);
+			positions.push_back(triangles_[i].coords[j].z);
+		}
+	}
+	if (vertexCount_ > 0) calculateBounds(&positions[0], vertexCount_, 3);
+
 	if (vertexArrayObjectSupported()) {
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		bindVertexArray(vao);
 	}
 	if (customBufferFunction == NULL) initBufferObj(bufferUsage); else (*customBufferFunction)(&vbo, this, customData);
-	if (vertexArrayObjectSupported()) glBindVertexArray(0);
+	if (vertexArrayObjectSupported()) bindVertexArray(0);
 	for (char i = 0; i < 16; i++) glDisableVertexAttribArray(i);
 }
 
 void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnum bufferUsage) {
+	SM_PROFILE_SCOPE("Model::loadSmm");
 	vector<string> text;
 	ifstream file;
 	file.open((path+fileName).c_str());
@@ -472,51 +724,16 @@ void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnu
 		return;
 	}
 	for (unsigned i = 0; i < arraySize; i++) data[i] = strtod(text[i+1].c_str(), NULL);
+	if (vertexCount_ > 0) calculateBounds(data, vertexCount_, 24);
 
 	if (vertexArrayObjectSupported()) {
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		bindVertexArray(vao);
 	}
 
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*vertexCount_*24, data, bufferUsage);
-
-	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24, 0);
-	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*4));
-	glVertexAttribPointer(COLOR0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*7));
-	glVertexAttribPointer(COLOR1_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*10));
-	glVertexAttribPointer(COLOR2_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*13));
-	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*16));
-	glVertexAttribPointer(EXTRA0_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*19));
-	glVertexAttribPointer(EXTRA1_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*20));
-	glVertexAttribPointer(EXTRA2_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*21));
-	glVertexAttribPointer(EXTRA3_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*22));
-	glVertexAttribPointer(EXTRA4_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*23));
-
-	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
-	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR0_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR1_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR2_ATTRIBUTE);
-	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA1_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA2_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA3_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA4_ATTRIBUTE);
+	uploadVertexArray(data, bufferUsage);
 
-	if (vertexArrayObjectSupported()) glBindVertexArray(0);
+	if (vertexArrayObjectSupported()) bindVertexArray(0);
 	delete[] data;
 
 	textureCount = atoi(text[arraySize+1].c_str());
@@ -534,7 +751,7 @@ void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnu
 				initialised = true;
 				glGenTextures(1, &texture);
 				if (texture2dArrayDisabled()) {
-					glBindTexture(GL_TEXTURE_2D, texture);
+					bindTexture(GL_TEXTURE_2D, texture);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 					if (openglVersion() >= 3.0f) glGenerateMipmap(GL_TEXTURE_2D);
@@ -543,7 +760,7 @@ void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnu
 					glTexImage2D(GL_TEXTURE_2D, 0, image->format->BytesPerPixel, image->w*textureCount,
 							image->h, 0, textureFormat, GL_UNSIGNED_BYTE, NULL);
 				} else {
-					glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+					bindTexture(GL_TEXTURE_2D_ARRAY, texture);
 					glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 					glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 					if (openglVersion() >= 3.0f) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
@@ -557,6 +774,7 @@ void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnu
 						GL_UNSIGNED_BYTE, image->pixels);
 			else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, image->w, image->h, 1, textureFormat,
 					GL_UNSIGNED_BYTE, image->pixels);
+			currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 			SDL_FreeSurface(image);
 		}
 		materials_.push_back(material());
@@ -566,6 +784,7 @@ void Model::loadSmm(const string & path, const string & fileName, bufferUsageEnu
 }
 
 void Model::loadSms(const string & fileName) {
+	SM_PROFILE_SCOPE("Model::loadSms");
 	vector<string> text;
 	ifstream file;
 	file.open(fileName.c_str());
@@ -630,6 +849,7 @@ void Model::loadSms(const string & fileName) {
 }
 
 void Model::loadSma(const string & fileName) {
+	SM_PROFILE_SCOPE("Model::loadSma");
 	vector<string> text;
 	ifstream file;
 	file.open(fileName.c_str());
@@ -672,6 +892,7 @@ void Model::loadSma(const string & fileName) {
 			line++;
 			newFrame.step = atoi(text[line].c_str());
 			line++;
+			newFrame.rotation = getRotationQuat(newFrame.xRot, newFrame.yRot, newFrame.zRot);
 			newAnimation.frames.push_back(newFrame);
 		}
 		bones_[boneId]->animations.push_back(newAnimation);
@@ -679,6 +900,7 @@ void Model::loadSma(const string & fileName) {
 }
 
 void Model::loadSmo(const string & path, const string & fileName, bufferUsageEnum bufferUsage) {
+	SM_PROFILE_SCOPE("Model::loadSmo");
 	vector<string> text;
 	ifstream file;
 	file.open((path+fileName).c_str());
@@ -763,228 +985,290 @@ void Model::initBufferObj(bufferUsageEnum bufferUsage) {
 		}
 	}
 
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*vertexCount_*24, vertexArray, bufferUsage);
-	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24, 0);
-	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*4));
-	glVertexAttribPointer(COLOR0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*7));
-	glVertexAttribPointer(COLOR1_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*10));
-	glVertexAttribPointer(COLOR2_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*13));
-	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*16));
-	glVertexAttribPointer(EXTRA0_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*19));
-	glVertexAttribPointer(EXTRA1_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*20));
-	glVertexAttribPointer(EXTRA2_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*21));
-	glVertexAttribPointer(EXTRA3_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*22));
-	glVertexAttribPointer(EXTRA4_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*23));
-
-	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
-	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR0_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR1_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR2_ATTRIBUTE);
-	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA1_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA2_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA3_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA4_ATTRIBUTE);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	uploadVertexArray(vertexArray, bufferUsage);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
 
 	delete[] vertexArray;
 }
 
 void Model::getBoneModelviewMatrices(mat4 * matrixArray, bone * pBone) {
 	pushMatrix();
-		translateMatrix(pBone->x, pBone->y, pBone->z);
-		rotateMatrix(pBone->xRot, 1.0f, 0.0f, 0.0f);
-		rotateMatrix(pBone->yRot, 0.0f, 1.0f, 0.0f);
-		rotateMatrix(pBone->zRot, 0.0f, 0.0f, 1.0f);
-		translateMatrix(-pBone->x, -pBone->y, -pBone->z);
+		//Rotate about the bone's position: translate(position)*rotation*translate(-position)
+		mat4 boneMatrix = pBone->rotation;
+		vec4 offset = vec4(pBone->x, pBone->y, pBone->z, 0.0f)*boneMatrix;
+		boneMatrix.component[12] = pBone->x-offset.x;
+		boneMatrix.component[13] = pBone->y-offset.y;
+		boneMatrix.component[14] = pBone->z-offset.z;
+		multiplyMatrix(boneMatrix);
 		matrixArray[pBone->id] = getMatrix(MODELVIEW_MATRIX);
 
 		for (unsigned i = 0; i < pBone->child.size(); i++) getBoneModelviewMatrices(matrixArray, pBone->child[i]);
 	popMatrix();
 }
 
-void Model::setBoneRotationsFromAnimation(unsigned animationId, float frame, bone * pBone) {
-	int index = pBone->animations[animationId].frameIndex(frame);
-	if (index == -1) {
-		if (frame > pBone->animations[animationId].frames.back().step) {
-			pBone->xRot = pBone->animations[animationId].frames.back().xRot;
-			pBone->yRot = pBone->animations[animationId].frames.back().yRot;
-			pBone->zRot = pBone->animations[animationId].frames.back().zRot;
+void Model::setBoneRotationsFromAnimation(const unsigned * animationIds, const float * frames, unsigned stride) {
+	const unsigned boneCount = bones_.size();
+	previousRotations_.resize(boneCount);
+	nextRotations_.resize(boneCount);
+	rotationSteps_.resize(boneCount);
+
+	//Find the key frames either side of the current frame for every bone, then interpolate them all at once
+	for (unsigned i = 0; i < boneCount; i++) {
+		bone * pBone = bones_[i];
+		unsigned animationId = animationIds[i*stride];
+		float frame = frames[i*stride];
+		rotationSteps_[i] = 0.0f;
+		if ((animationId >= pBone->animations.size()) || pBone->animations[animationId].frames.empty()) {
+			previousRotations_[i] = nextRotations_[i] = pBone->rotation;
+			continue;
+		}
+
+		vector<bone::keyFrame> & keyFrames = pBone->animations[animationId].frames;
+		if (frame <= keyFrames.front().step) {
+			previousRotations_[i] = nextRotations_[i] = keyFrames.front().rotation;
+		} else if (frame >= keyFrames.back().step) {
+			previousRotations_[i] = nextRotations_[i] = keyFrames.back().rotation;
 		} else {
-			bone::keyFrame * previousFrame, * nextFrame;
-			int i = 0;
-			while (frame > pBone->animations[animationId].frames[i].step) i++;
-			previousFrame = &pBone->animations[animationId].frames[i-1];
-			nextFrame = &pBone->animations[animationId].frames[i];
-
-			float xDiff, yDiff, zDiff,
-				xDiff1 = nextFrame->xRot-previousFrame->xRot,
-				yDiff1 = nextFrame->yRot-previousFrame->yRot,
-				zDiff1 = nextFrame->zRot-previousFrame->zRot,
-
-				xDiff2 = (360.0f-abs(previousFrame->xRot))-abs(nextFrame->xRot),
-				yDiff2 = (360.0f-abs(previousFrame->yRot))-abs(nextFrame->yRot),
-				zDiff2 = (360.0f-abs(previousFrame->zRot))-abs(nextFrame->zRot),
-
-				stepDiff = nextFrame->step-previousFrame->step;
-
-			xDiff = (abs(xDiff1) < xDiff2) ? xDiff1 : ((previousFrame->xRot < 0.0f) ? -xDiff2 : xDiff2);
-			yDiff = (abs(yDiff1) < yDiff2) ? yDiff1 : ((previousFrame->yRot < 0.0f) ? -yDiff2 : yDiff2);
-			zDiff = (abs(zDiff1) < zDiff2) ? zDiff1 : ((previousFrame->zRot < 0.0f) ? -zDiff2 : zDiff2);
-
-			float multiplier = (frame-previousFrame->step)/stepDiff;
-			pBone->xRot = previousFrame->xRot+(xDiff*multiplier);
-			pBone->yRot = previousFrame->yRot+(yDiff*multiplier);
-			pBone->zRot = previousFrame->zRot+(zDiff*multiplier);
+			unsigned j = 1;
+			while (frame > keyFrames[j].step) j++;
+			bone::keyFrame & previousFrame = keyFrames[j-1], & nextFrame = keyFrames[j];
+			previousRotations_[i] = previousFrame.rotation;
+			nextRotations_[i] = nextFrame.rotation;
+			rotationSteps_[i] = (frame-previousFrame.step)/float(nextFrame.step-previousFrame.step);
 		}
-	} else {
-		pBone->xRot = pBone->animations[animationId].frames[index].xRot;
-		pBone->yRot = pBone->animations[animationId].frames[index].yRot;
-		pBone->zRot = pBone->animations[animationId].frames[index].zRot;
 	}
+
+	if (boneCount > 0) slerp(&previousRotations_[0], &nextRotations_[0], &rotationSteps_[0], &previousRotations_[0],
+			boneCount);
+	for (unsigned i = 0; i < boneCount; i++) bones_[i]->rotation = previousRotations_[i];
 }
 
 string Model::name() {
 	return name_;
 }
 
-inline void setupVertexAttribs() {
-	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24, 0);
-	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*4));
-	glVertexAttribPointer(COLOR0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*7));
-	glVertexAttribPointer(COLOR1_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*10));
-	glVertexAttribPointer(COLOR2_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*13));
-	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*16));
-	glVertexAttribPointer(EXTRA0_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*19));
-	glVertexAttribPointer(EXTRA1_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*20));
-	glVertexAttribPointer(EXTRA2_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*21));
-	glVertexAttribPointer(EXTRA3_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*22));
-	glVertexAttribPointer(EXTRA4_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*24,
-			(const GLvoid*)(sizeof(GLfloat)*23));
+static float lodThreshold = 1.0f;
+//Moving to a simpler level needs its error to be this far under the threshold
+const float LOD_HYSTERESIS = 0.75f;
 
-	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
-	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR0_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR1_ATTRIBUTE);
-	glEnableVertexAttribArray(COLOR2_ATTRIBUTE);
-	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA0_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA1_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA2_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA3_ATTRIBUTE);
-	glEnableVertexAttribArray(EXTRA4_ATTRIBUTE);
+void setModelLodThreshold(float pixels) {
+	lodThreshold = pixels;
 }
 
+float modelLodThreshold() {
+	return lodThreshold;
+}
+
+unsigned Model::selectLod(unsigned currentLevel) {
+	if ((lods_.size() < 2) || (lodThreshold <= 0.0f)) return 0;
+	if (currentLevel >= lods_.size()) currentLevel = 0;
+	mat4 modelview = getMatrix(MODELVIEW_MATRIX), projection = getMatrix(PROJECTION_MATRIX);
+	float centre[4] = {sphereBounds_.centre.x, sphereBounds_.centre.y, sphereBounds_.centre.z, 1.0f}, viewCentre[4],
+		clipCentre[4];
+	multiplyMat4Vec4(modelview.component, centre, viewCentre);
+	multiplyMat4Vec4(projection.component, viewCentre, clipCentre);
+	if (clipCentre[3] <= 0.0f) return currentLevel;
+
+	//How many pixels one unit of the model covers at its centre, using the largest scale in the modelview matrix
+	float largestScaleSquared = 0.0f;
+	for (short i = 0; i < 3; i++) {
+		const float * column = modelview.component+(i*4);
+		float scaleSquared = (column[0]*column[0])+(column[1]*column[1])+(column[2]*column[2]);
+		if (scaleSquared > largestScaleSquared) largestScaleSquared = scaleSquared;
+	}
+	float pixelsPerUnit = sqrt(largestScaleSquared)*fabs(projection.component[5])*0.5f*screenHeight()/clipCentre[3];
+
+	unsigned level = currentLevel;
+	while ((level > 0) && (lods_[level].error*pixelsPerUnit > lodThreshold)) level--;
+	while ((level+1 < lods_.size()) && (lods_[level+1].error*pixelsPerUnit <= lodThreshold*LOD_HYSTERESIS)) level++;
+	return level;
+}
+
+//Draws with the current modelview matrix, or queues the draw if the render queue is on
+void Model::submitDraw(Shader * shaderToUse, mat4 * boneMatrices, unsigned boneCount, unsigned lod) {
+	//Palettes stay in the texture buffer until the frame after next, so queued draws only need the offset
+	long paletteOffset = (boneCount > 0) ? writeBonePalette(boneMatrices, boneCount) : -1;
+	if (paletteOffset >= 0) boneCount = 0;
+	GLenum textureTarget = texture2dArrayDisabled() ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY;
+	unsigned firstIndex = 0, indexCount = vertexCount_;
+	if (lod < lods_.size()) firstIndex = lods_[lod].firstIndex, indexCount = lods_[lod].indexCount;
+	GLsizeiptr indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+	if (renderQueueEnabled() && vertexArrayObjectSupported()) {
+		renderCommand command(shaderToUse, textureTarget, texture, vao, vbo, indexCount);
+		command.firstVertex = firstIndex;
+		command.indexType = indexType;
+		command.materialBuffer = materialUbo;
+		if (texture2dArrayDisabled()) command.textureCount = textureCount;
+		command.bonePaletteOffset = paletteOffset;
+		queueRenderCommand(command, boneMatrices, boneCount);
+		return;
+	}
+
+	bindProgram(shaderToUse->program_);
+	bindTexture(textureTarget, texture);
+	if (texture2dArrayDisabled()) shaderToUse->setUniform1(TEXCOMPAT_LOCATION, (int)textureCount);
+	shaderToUse->setUniform1(TEXSAMPLER_LOCATION, 0);
+	shaderToUse->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
+	shaderToUse->setProjectionUniform();
+	if (boneCount > 0) shaderToUse->setUniform16(EXTRA0_LOCATION, (float*)boneMatrices, boneCount);
+	if (paletteOffset >= 0) shaderToUse->setBonePaletteUniforms(paletteOffset);
+	if (materialUbo != 0) bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BLOCK, materialUbo);
+
+	if (vertexArrayObjectSupported()) bindVertexArray(vao); else {
+		bindBuffer(GL_ARRAY_BUFFER, vbo);
+		if (materialUbo != 0) setupCompactVertexAttribs(); else setupVertexAttribs();
+		if (ibo != 0) bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	}
+	if (ibo != 0) glDrawElements(GL_TRIANGLES, indexCount, indexType, (const GLvoid*)(firstIndex*indexSize));
+	else glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
+	currentRenderStats().drawCalls++;
+	currentRenderStats().triangles += indexCount/3;
+}
+
+//Sized for the largest skeleton drawn so far
+static vector<mat4> boneMatrices;
+
 void Model::draw(float x, float y, float z, float xRotation, float yRotation, float zRotation, float xScale,
 		float yScale, float zScale, float frame, int currentAnimationId, bool skipAnimation) {
+	SM_PROFILE_SCOPE("Model::draw");
 	Shader * shaderToUse;
 	if (boundShader_ != NULL) shaderToUse = boundShader_; else shaderToUse = ::boundShader();
 
 	if (shaderToUse != NULL) {
-		glUseProgram(shaderToUse->program_);
-		if (texture2dArrayDisabled()) {
-			glBindTexture(GL_TEXTURE_2D, texture);
-			shaderToUse->setUniform1(TEXCOMPAT_LOCATION, (int)textureCount);
-		} else glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
-		shaderToUse->setUniform1(TEXSAMPLER_LOCATION, 0);
-
 		setMatrix(MODELVIEW_MATRIX);
 		pushMatrix();
-			translateMatrix(x, y, z);
-			rotateMatrix(xRotation, 1.0f, 0.0f, 0.0f);
-			rotateMatrix(yRotation, 0.0f, 1.0f, 0.0f);
-			rotateMatrix(zRotation, 0.0f, 0.0f, 1.0f);
-			scaleMatrix(xScale, yScale, zScale);
-
-			shaderToUse->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
-			shaderToUse->setUniform16(PROJECTION_LOCATION, getMatrix(PROJECTION_MATRIX));
+			transformMatrix(vec3(x, y, z), vec3(xRotation, yRotation, zRotation), vec3(xScale, yScale, zScale));
 
+			unsigned boneCount = 0;
 			if (!skipAnimation && (bones_.size() > 0)) {
-				for (unsigned i = 0; i < bones_.size(); i++)
-					setBoneRotationsFromAnimation(currentAnimationId, frame, bones_[i]);
-				const int arraySize = 64;
-				mat4 matrixArray[arraySize];
-				getBoneModelviewMatrices(matrixArray, bones_.front());
-				shaderToUse->setUniform16(EXTRA0_LOCATION, (float*)matrixArray, bones_.size());
+				unsigned animationId = currentAnimationId;
+				boneCount = bones_.size();
+				boneMatrices.resize(boneCount);
+				setBoneRotationsFromAnimation(&animationId, &frame, 0);
+				getBoneModelviewMatrices(&boneMatrices[0], bones_.front());
 			}
-
-			if (vertexArrayObjectSupported()) glBindVertexArray(vao); else {
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
-				setupVertexAttribs();
-			}
-			glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
-			if (vertexArrayObjectSupported()) glBindVertexArray(0); else glBindBuffer(GL_ARRAY_BUFFER, 0);
+			submitDraw(shaderToUse, boneCount > 0 ? &boneMatrices[0] : NULL, boneCount, selectLod(0));
 		popMatrix();
 	}
-	if (::boundShader() != NULL) glUseProgram(::boundShader()->program_); else glUseProgram(0);
 }
 
 void Model::draw(Object & object, bool skipAnimation) {
+	SM_PROFILE_SCOPE("Model::draw");
 	Shader * shaderToUse;
 	if (object.boundShader_ != NULL) shaderToUse = object.boundShader_;
 	else if (boundShader_ != NULL) shaderToUse = boundShader_;
 	else shaderToUse = ::boundShader();
 
 	if (shaderToUse != NULL) {
-		glUseProgram(shaderToUse->program_);
-		if (texture2dArrayDisabled()) {
-			glBindTexture(GL_TEXTURE_2D, texture);
-			shaderToUse->setUniform1(TEXCOMPAT_LOCATION, (int)textureCount);
-		} else glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
-		shaderToUse->setUniform1(TEXSAMPLER_LOCATION, 0);
-
 		setMatrix(MODELVIEW_MATRIX);
 		pushMatrix();
-			translateMatrix(object.x_, object.y_, object.z_);
-			rotateMatrix(object.xRotation_, 1.0f, 0.0f, 0.0f);
-			rotateMatrix(object.yRotation_, 0.0f, 1.0f, 0.0f);
-			rotateMatrix(object.zRotation_, 0.0f, 0.0f, 1.0f);
-			scaleMatrix(object.xScale_, object.yScale_, object.zScale_);
-
-			shaderToUse->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
-			shaderToUse->setUniform16(PROJECTION_LOCATION, getMatrix(PROJECTION_MATRIX));
+			vec3 position, rotation, scale;
+			object.getInterpolatedState(&position, &rotation, &scale, NULL);
+			transformMatrix(position, rotation, scale);
 
+			unsigned boneCount = 0;
 			if (!skipAnimation && (bones_.size() > 0)) {
-				for (unsigned i = 0; i < bones_.size(); i++)
-					setBoneRotationsFromAnimation(object.currentAnimationId[i], object.frame_[i], bones_[i]);
-				const int arraySize = 64;
-				mat4 matrixArray[arraySize];
-				getBoneModelviewMatrices(matrixArray, bones_.front());
-				shaderToUse->setUniform16(EXTRA0_LOCATION, (float*)matrixArray, bones_.size());
+				boneCount = bones_.size();
+				boneMatrices.resize(boneCount);
+				setBoneRotationsFromAnimation(&object.currentAnimationId[0], &object.frame_[0], 1);
+				getBoneModelviewMatrices(&boneMatrices[0], bones_.front());
 			}
-
-			if (vertexArrayObjectSupported()) glBindVertexArray(vao); else {
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
-				setupVertexAttribs();
-			}
-			glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
-			if (vertexArrayObjectSupported()) glBindVertexArray(0); else glBindBuffer(GL_ARRAY_BUFFER, 0);
+			object.lodLevel_ = selectLod(object.lodLevel_);
+			submitDraw(shaderToUse, boneCount > 0 ? &boneMatrices[0] : NULL, boneCount, object.lodLevel_);
 		popMatrix();
 	}
-	if (::boundShader() != NULL) glUseProgram(::boundShader()->program_); else glUseProgram(0);
+}
+
+//A column major transformation matrix followed by alpha, frame, animation and the first texel of the bone palette
+const unsigned INSTANCE_FLOAT_COUNT = 20;
+static vector<GLfloat> instanceData;
+
+void Model::drawInstanced(Object * const * objects, unsigned count, bool skipAnimation) {
+	if (count == 0) return;
+	bool skinned = !skipAnimation && (bones_.size() > 0);
+	if (!instancingSupported() || (skinned && !boneTexturesEnabled())) {
+		for (unsigned i = 0; i < count; i++) draw(*objects[i], skipAnimation);
+		return;
+	}
+	Shader * shaderToUse;
+	if (boundShader_ != NULL) shaderToUse = boundShader_; else shaderToUse = ::boundShader();
+	if (shaderToUse == NULL) return;
+	SM_PROFILE_SCOPE("Model::drawInstanced");
+
+	unsigned boneCount = skinned ? bones_.size() : 0;
+	boneMatrices.resize(boneCount*count);
+	instanceData.resize(count*INSTANCE_FLOAT_COUNT);
+	setMatrix(MODELVIEW_MATRIX);
+	for (unsigned i = 0; i < count; i++) {
+		Object & object = *objects[i];
+		vec3 position, rotation, scale;
+		float alpha;
+		object.getInterpolatedState(&position, &rotation, &scale, &alpha);
+		mat4 transformation = getTransformationMatrix(position, rotation, scale);
+		GLfloat * instance = &instanceData[i*INSTANCE_FLOAT_COUNT];
+		for (unsigned j = 0; j < 16; j++) instance[j] = transformation.component[j];
+		instance[16] = alpha;
+		instance[17] = object.frame_.empty() ? 0.0f : object.frame_.front();
+		instance[18] = object.currentAnimationId.empty() ? 0.0f : object.currentAnimationId.front();
+		instance[19] = i*boneCount*4.0f;
+		if (skinned) {
+			pushMatrix();
+				multiplyMatrix(transformation);
+				setBoneRotationsFromAnimation(&object.currentAnimationId[0], &object.frame_[0], 1);
+				getBoneModelviewMatrices(&boneMatrices[i*boneCount], bones_.front());
+			popMatrix();
+		}
+	}
+	//Every palette goes in with one write, so each instance's offset is relative to the first
+	long paletteOffset = -1;
+	if (skinned) {
+		paletteOffset = writeBonePalette(&boneMatrices[0], boneCount*count);
+		if (paletteOffset < 0) {
+			for (unsigned i = 0; i < count; i++) draw(*objects[i], skipAnimation);
+			return;
+		}
+		for (unsigned i = 0; i < count; i++) instanceData[(i*INSTANCE_FLOAT_COUNT)+19] += paletteOffset;
+	}
+
+	bindVertexArray(vao);
+	if (instanceVbo == 0) {
+		glGenBuffers(1, &instanceVbo);
+		bindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+		//The four matrix columns, then the instance data. The vertex array object remembers these, so they are only
+		//set up once
+		GLsizei stride = sizeof(GLfloat)*INSTANCE_FLOAT_COUNT;
+		for (unsigned i = 0; i < 5; i++) {
+			glVertexAttribPointer(INSTANCE_MATRIX_ATTRIBUTE+i, 4, GL_FLOAT, GL_FALSE, stride,
+					(const GLvoid*)(sizeof(GLfloat)*4*i));
+			glVertexAttribDivisor(INSTANCE_MATRIX_ATTRIBUTE+i, 1);
+			glEnableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE+i);
+		}
+	} else bindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	//Grow to fit, or orphan the old contents so the driver does not wait for the last draw to finish with them
+	if (count > instanceCapacity) instanceCapacity = count;
+	GLsizeiptr size = sizeof(GLfloat)*INSTANCE_FLOAT_COUNT*count;
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*INSTANCE_FLOAT_COUNT*instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, &instanceData[0]);
+	currentRenderStats().bytesUploaded += size;
+
+	GLenum textureTarget = texture2dArrayDisabled() ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY;
+	bindProgram(shaderToUse->program_);
+	bindTexture(textureTarget, texture);
+	if (texture2dArrayDisabled()) shaderToUse->setUniform1(TEXCOMPAT_LOCATION, (int)textureCount);
+	shaderToUse->setUniform1(TEXSAMPLER_LOCATION, 0);
+	shaderToUse->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
+	shaderToUse->setProjectionUniform();
+	if (paletteOffset >= 0) shaderToUse->setBonePaletteUniforms(paletteOffset);
+	if (materialUbo != 0) bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BLOCK, materialUbo);
+
+	if (ibo != 0) glDrawElementsInstanced(GL_TRIANGLES, vertexCount_, indexType, 0, count);
+	else glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount_, count);
+	currentRenderStats().drawCalls++;
+	currentRenderStats().triangles += (unsigned long long)(vertexCount_/3)*count;
+}
+
+void Model::drawInstanced(const vector<Object *> & objects, bool skipAnimation) {
+	if (!objects.empty()) drawInstanced(&objects[0], objects.size(), skipAnimation);
 }
 
 void Model::bindShader(Shader * shader) {
@@ -1041,6 +1325,23 @@ unsigned Model::vertexCount() {
 	return vertexCount_;
 }
 
+boundingBox Model::bounds() {
+	return bounds_;
+}
+
+boundingSphere Model::sphereBounds() {
+	return sphereBounds_;
+}
+
+unsigned Model::lodCount() {
+	return lods_.empty() ? 1 : lods_.size();
+}
+
+unsigned Model::lodTriangleCount(unsigned level) {
+	if (lods_.empty()) return (level == 0) ? vertexCount_/3 : 0;
+	return (level < lods_.size()) ? lods_[level].indexCount/3 : 0;
+}
+
 int bone::animation::frameIndex(float step) {
 	for (unsigned i = 0; i < frames.size(); i++) {
 		if ((float)frames[i].step == step) {
@@ -16,9 +16,11 @@ using namespace std;
 #include "../../headers/classes/Object.h"
 #include "../../headers/classes/Sprite.h"
 #include "../../headers/classes/Model.h"
+#include "../../headers/classes/OcclusionBuffer.h"
 #include "../../headers/Display.h"
 #include "../../headers/Utils.h"
 #include "../../headers/Input.h"
+#include "../../headers/Profiler.h"
 using namespace SuperMaximo;
 
 namespace SuperMaximo {
@@ -35,6 +37,8 @@ Object::Object(const string & newName, float destX, float destY, float destZ, Sp
 	zRotatedWidth_ = width_, zRotatedHeight_ = height_;
 	boundShader_ = NULL;
 	customDrawFunction = NULL;
+	lodLevel_ = 0;
+	initSnapshot();
 }
 
 Object::Object(const string & newName, float destX, float destY, float destZ, Model * newModel) {
@@ -51,6 +55,43 @@ Object::Object(const string & newName, float destX, float destY, float destZ, Mo
 	hasModel_ = true;
 	boundShader_ = NULL;
 	customDrawFunction = NULL;
+	lodLevel_ = 0;
+	initSnapshot();
+}
+
+void Object::initSnapshot() {
+	previousX_ = x_, previousY_ = y_, previousZ_ = z_;
+	previousXRotation_ = xRotation_, previousYRotation_ = yRotation_, previousZRotation_ = zRotation_;
+	previousXScale_ = xScale_, previousYScale_ = yScale_, previousZScale_ = zScale_;
+	previousAlpha_ = alpha_;
+	snapshotTick_ = simulationTick();
+}
+
+void Object::snapshot() {
+	if (snapshotTick_ != simulationTick()) initSnapshot();
+}
+
+static float interpolate(float previous, float current, float alpha) {
+	return previous+((current-previous)*alpha);
+}
+
+//Rotations are kept within 0-360, so take the short way round when they wrap
+static float interpolateAngle(float previous, float current, float alpha) {
+	float difference = current-previous;
+	if (difference > 180.0f) difference -= 360.0f; else if (difference < -180.0f) difference += 360.0f;
+	return previous+(difference*alpha);
+}
+
+void Object::getInterpolatedState(vec3 * position, vec3 * rotation, vec3 * scale, float * alpha) {
+	float interpolation = (snapshotTick_+1 == simulationTick()) ? interpolationAlpha() : 1.0f;
+	*position = vec3(interpolate(previousX_, x_, interpolation), interpolate(previousY_, y_, interpolation),
+			interpolate(previousZ_, z_, interpolation));
+	*rotation = vec3(interpolateAngle(previousXRotation_, xRotation_, interpolation),
+			interpolateAngle(previousYRotation_, yRotation_, interpolation),
+			interpolateAngle(previousZRotation_, zRotation_, interpolation));
+	*scale = vec3(interpolate(previousXScale_, xScale_, interpolation),
+			interpolate(previousYScale_, yScale_, interpolation), interpolate(previousZScale_, zScale_, interpolation));
+	if (alpha != NULL) *alpha = interpolate(previousAlpha_, alpha_, interpolation);
 }
 
 string Object::name() {
@@ -111,30 +152,36 @@ customDrawFunctionType Object::boundCustomDrawFunction() {
 }
 
 void Object::setPosition(float xAmount, float yAmount, float zAmount, bool relative) {
+	snapshot();
 	if (relative) x_ += xAmount*compensation(), y_ += yAmount*compensation(), z_ += zAmount*compensation();
 		else x_ = xAmount, y_ = yAmount, z_ = zAmount;
 }
 
 void Object::setPosition(vec2 amount, bool relative) {
+	snapshot();
 	if (relative) x_ += amount.x*compensation(), y_ += amount.y*compensation(); else x_ = amount.x, y_ = amount.y;
 }
 
 void Object::setPosition(vec3 amount, bool relative) {
+	snapshot();
 	if (relative) x_ += amount.x*compensation(), y_ += amount.y*compensation(), z_ += amount.z*compensation();
 		else x_ = amount.x, y_ = amount.y, z_ = amount.z;
 }
 
 float Object::setX(float amount, bool relative) {
+	snapshot();
 	if (relative) x_ += amount*compensation(); else x_ = amount;
 	return x_;
 }
 
 float Object::setY(float amount, bool relative) {
+	snapshot();
 	if (relative) y_ += amount*compensation(); else y_ = amount;
 	return y_;
 }
 
 float Object::setZ(float amount, bool relative) {
+	snapshot();
 	if (relative) z_ += amount*compensation(); else z_ = amount;
 	return z_;
 }
@@ -180,13 +227,12 @@ void Object::calcZRotatedDimensions() {
 		pointX[3] = -originX+width_;
 		pointY[3] = -originY;
 
-		float zRotToRad = (zRotation_*pi)/180.0f;
+		float s, c;
+		sinCos(zRotation_, &s, &c);
 		for (short i = 0; i < 4; i++) {
-			float pointDistSquared = (pointX[i]*pointX[i])+(pointY[i]*pointY[i]);
-			float angle = atan2(pointY[i], pointX[i]);
-			float calc = angle-zRotToRad;
-			pointX[i] = pointDistSquared*cos(calc);
-			pointY[i] = pointDistSquared*sin(calc);
+			float x = pointX[i];
+			pointX[i] = (x*c)+(pointY[i]*s);
+			pointY[i] = (pointY[i]*c)-(x*s);
 		}
 		float wLowerBound = pointX[0], wUpperBound = pointX[0], hLowerBound = pointY[0], hUpperBound = pointY[0];
 		for (short i = 0; i < 4; i++) {
@@ -195,12 +241,13 @@ void Object::calcZRotatedDimensions() {
 			if (pointY[i] < hLowerBound) hLowerBound = pointY[i];
 			if (pointY[i] > hUpperBound) hUpperBound = pointY[i];
 		}
-		zRotatedWidth_ = sqrt(wUpperBound-wLowerBound);
-		zRotatedHeight_ = sqrt(hUpperBound-hLowerBound);
+		zRotatedWidth_ = wUpperBound-wLowerBound;
+		zRotatedHeight_ = hUpperBound-hLowerBound;
 	}
 }
 
 void Object::scale(float xAmount, float yAmount, float zAmount, bool relative, bool recalculateDimensions) {
+	snapshot();
 	if (relative) xScale_ += xAmount*compensation(),
 			yScale_ += yAmount*compensation(),
 			zScale_ += zAmount*compensation();
@@ -210,16 +257,19 @@ void Object::scale(float xAmount, float yAmount, float zAmount, bool relative, b
 }
 
 float Object::setXScale(float amount, bool relative) {
+	snapshot();
 	if (relative) xScale_ += amount*compensation(); else xScale_ = amount;
 	return xScale_;
 }
 
 float Object::setYScale(float amount, bool relative) {
+	snapshot();
 	if (relative) yScale_ += amount*compensation(); else yScale_ = amount;
 	return yScale_;
 }
 
 float Object::setZScale(float amount, bool relative) {
+	snapshot();
 	if (relative) zScale_ += amount*compensation(); else zScale_ = amount;
 	return zScale_;
 }
@@ -237,6 +287,7 @@ float Object::zScale() {
 }
 
 void Object::rotate(float xAmount, float yAmount, float zAmount, bool relative, bool recalculateDimensions) {
+	snapshot();
 	if (relative) xRotation_ += xAmount*compensation(), yRotation_ += yAmount*compensation(),
 			zRotation_ += zAmount*compensation();
 		else xRotation_ = xAmount, yRotation_ = yAmount, zRotation_ = zAmount;
@@ -247,6 +298,7 @@ void Object::rotate(float xAmount, float yAmount, float zAmount, bool relative,
 }
 
 float Object::rotate(float amount, bool relative, bool recalculateDimensions) {
+	snapshot();
 	if (relative) zRotation_ += amount*compensation(); else zRotation_ = amount;
 	if (zRotation_ >= 360.0f) zRotation_ -= 360.0f; else if (zRotation_ < 0.0f) zRotation_ += 360.0f;
 	if (recalculateDimensions) calcZRotatedDimensions();
@@ -254,16 +306,19 @@ float Object::rotate(float amount, bool relative, bool recalculateDimensions) {
 }
 
 float Object::setXRotation(float amount, bool relative) {
+	snapshot();
 	if (relative) xRotation_ += amount*compensation(); else xRotation_ = amount;
 	return xRotation_;
 }
 
 float Object::setYRotation(float amount, bool relative) {
+	snapshot();
 	if (relative) yRotation_ += amount*compensation(); else yRotation_ = amount;
 	return yRotation_;
 }
 
 float Object::setZRotation(float amount, bool relative) {
+	snapshot();
 	if (relative) zRotation_ += amount*compensation(); else zRotation_ = amount;
 	return zRotation_;
 }
@@ -281,6 +336,7 @@ float Object::zRotation() {
 }
 
 float Object::setAlpha(float amount, bool relative) {
+	snapshot();
 	if (relative) alpha_ += amount*compensation(); else alpha_ = amount;
 	return alpha_;
 }
@@ -346,6 +402,32 @@ void Object::draw(bool skipAnimation) {
 	}
 }
 
+bool Object::getBoundingSphere(boundingSphere * sphere) {
+	if (hasModel_ ? (model_ == NULL) : (sprite_ == NULL)) return false;
+	vec3 position, rotation, scale;
+	getInterpolatedState(&position, &rotation, &scale, NULL);
+	if (hasModel_) {
+		boundingSphere modelSphere = model_->sphereBounds();
+		mat4 transformation = getTransformationMatrix(position, rotation, scale);
+		float centre[4] = {modelSphere.centre.x, modelSphere.centre.y, modelSphere.centre.z, 1.0f}, result[4];
+		multiplyMat4Vec4(transformation.component, centre, result);
+		float largestScale = fabs(scale.x);
+		if (fabs(scale.y) > largestScale) largestScale = fabs(scale.y);
+		if (fabs(scale.z) > largestScale) largestScale = fabs(scale.z);
+		sphere->centre = vec3(result[0], result[1], result[2]);
+		sphere->radius = modelSphere.radius*largestScale;
+	} else {
+		//Sprites rotate about their origin, so the sphere around it reaches the furthest corner at any rotation
+		float left = fabs(float(sprite_->originX_)), right = fabs(float(sprite_->rect.w-sprite_->originX_));
+		float top = fabs(float(sprite_->originY_)), bottom = fabs(float(sprite_->rect.h-sprite_->originY_));
+		float xExtent = ((left > right) ? left : right)*fabs(scale.x);
+		float yExtent = ((top > bottom) ? top : bottom)*fabs(scale.y);
+		sphere->centre = position;
+		sphere->radius = sqrt((xExtent*xExtent)+(yExtent*yExtent));
+	}
+	return true;
+}
+
 bool Object::mouseOverBox() {
 	if (!hasModel_) {
 		vec2 vertex[4] = {
@@ -356,7 +438,7 @@ bool Object::mouseOverBox() {
 		};
 
 		if ((zRotation_ != 0.0f) && (zRotation_ != 180.0f))
-			for (short i = 0; i < 4; i++) vertex[i] *= get2dRotationMatrix(zRotation_);
+			transformPoints(get2dRotationMatrix(zRotation_), vertex, vertex, 4);
 
 		return vec2(mouseX(), mouseY()).polygonCollision(4, vertex);
 	}
@@ -401,9 +483,9 @@ bool Object::boxCollision(Object * other, bool allStages) {
 		};
 
 		if ((zRotation_ != 0.0f) && (zRotation_ != 180.0f))
-			for (short i = 0; i < 4; i++) box[i] *= get2dRotationMatrix(zRotation_);
+			transformPoints(get2dRotationMatrix(zRotation_), box, box, 4);
 		if ((other->zRotation_ != 0.0f) && (other->zRotation_ != 180.0f))
-			for (short i = 0; i < 4; i++) box[i] *= get2dRotationMatrix(other->zRotation_);
+			transformPoints(get2dRotationMatrix(other->zRotation_), otherBox, otherBox, 4);
 
 		for (short i = 0; i < 4; i++) if (box[i].polygonCollision(4, otherBox)) return true;
 
@@ -435,4 +517,49 @@ bool Object::circleCollision(Object * other) {
 	return false;
 }
 
+static vector<float> cullX, cullY, cullZ, cullRadius;
+static vector<unsigned char> cullVisible;
+
+unsigned cullObjects(Object * const * objects, unsigned count, const frustum & viewFrustum,
+		vector<Object *> * visible) {
+	SM_PROFILE_SCOPE("cullObjects");
+	cullX.resize(count), cullY.resize(count), cullZ.resize(count), cullRadius.resize(count);
+	cullVisible.resize(count);
+	for (unsigned i = 0; i < count; i++) {
+		boundingSphere sphere;
+		//An infinite radius keeps objects without bounds
+		if (!objects[i]->getBoundingSphere(&sphere)) sphere.radius = INFINITY;
+		cullX[i] = sphere.centre.x, cullY[i] = sphere.centre.y, cullZ[i] = sphere.centre.z;
+		cullRadius[i] = sphere.radius;
+	}
+	if (count == 0) return 0;
+	unsigned visibleCount = cullSpheres(viewFrustum, &cullX[0], &cullY[0], &cullZ[0], &cullRadius[0],
+			&cullVisible[0], count);
+	for (unsigned i = 0; i < count; i++) if (cullVisible[i]) visible->push_back(objects[i]);
+	return visibleCount;
+}
+
+unsigned cullObjects(const vector<Object *> & objects, const frustum & viewFrustum, vector<Object *> * visible) {
+	return objects.empty() ? 0 : cullObjects(&objects[0], objects.size(), viewFrustum, visible);
+}
+
+static vector<Object *> visibleObjects;
+
+unsigned drawVisibleObjects(Object * const * objects, unsigned count, bool skipAnimation,
+		OcclusionBuffer * occlusionBuffer) {
+	visibleObjects.clear();
+	unsigned visibleCount = cullObjects(objects, count, getViewFrustum(), &visibleObjects), drawnCount = 0;
+	for (unsigned i = 0; i < visibleCount; i++) {
+		if ((occlusionBuffer != NULL) && (!occlusionBuffer->objectVisible(*visibleObjects[i]))) continue;
+		visibleObjects[i]->draw(skipAnimation);
+		drawnCount++;
+	}
+	currentRenderStats().objectsCulled += count-drawnCount;
+	return drawnCount;
+}
+
+unsigned drawVisibleObjects(const vector<Object *> & objects, bool skipAnimation, OcclusionBuffer * occlusionBuffer) {
+	return objects.empty() ? 0 : drawVisibleObjects(&objects[0], objects.size(), skipAnimation, occlusionBuffer);
+}
+
 }
@@ -0,0 +1,295 @@
+//============================================================================
+// Name        : OcclusionBuffer.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary OcclusionBuffer class for software occlusion culling
+//============================================================================
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+#include "../../headers/classes/OcclusionBuffer.h"
+#include "../../headers/classes/Object.h"
+#include "../../headers/classes/Model.h"
+#include "../../headers/Display.h"
+#include "../../headers/Profiler.h"
+using namespace SuperMaximo;
+
+//Clip space w below which a vertex counts as behind the camera
+static const float NEAR_W = 0.00001f;
+//Triangles covering less area than this in pixels squared are skipped, as their edges and depth cannot be trusted
+static const float MIN_AREA = 0.0001f;
+//How far in front of a box an occluder has to be, so an occluder never hides itself through rounding
+static const float DEPTH_TOLERANCE = 0.00001f;
+static const unsigned TILE_PIXELS = OCCLUSION_TILE_WIDTH*OCCLUSION_TILE_HEIGHT;
+
+namespace SuperMaximo {
+
+OcclusionBuffer::OcclusionBuffer(unsigned width, unsigned height) {
+	tilesX = (width+OCCLUSION_TILE_WIDTH-1)/OCCLUSION_TILE_WIDTH;
+	tilesY = (height+OCCLUSION_TILE_HEIGHT-1)/OCCLUSION_TILE_HEIGHT;
+	if (tilesX == 0) tilesX = 1;
+	if (tilesY == 0) tilesY = 1;
+	width_ = tilesX*OCCLUSION_TILE_WIDTH, height_ = tilesY*OCCLUSION_TILE_HEIGHT;
+	//Each tile's pixels are stored together, a row at a time
+	depth_.resize(width_*height_, 1.0f);
+	tileMaxDepth.resize(tilesX*tilesY, 1.0f);
+	bins.resize(tilesX*tilesY);
+	viewProjection.initIdentity();
+	resolved = true;
+}
+
+void OcclusionBuffer::clear(const mat4 & viewProjection) {
+	this->viewProjection = viewProjection;
+	triangles.clear();
+	for (unsigned i = 0; i < bins.size(); i++) bins[i].clear();
+	resolved = false;
+}
+
+void OcclusionBuffer::binTriangle(const vec4 & a, const vec4 & b, const vec4 & c) {
+	//Triangles crossing the near plane would need clipping, and leaving them out only lets more through
+	if ((a.w <= NEAR_W) || (b.w <= NEAR_W) || (c.w <= NEAR_W)) return;
+	const vec4 * corners[3] = {&a, &b, &c};
+	float x[3], y[3], z[3];
+	for (short i = 0; i < 3; i++) {
+		float inverseW = 1.0f/corners[i]->w;
+		x[i] = ((corners[i]->x*inverseW*0.5f)+0.5f)*width_;
+		y[i] = ((corners[i]->y*inverseW*0.5f)+0.5f)*height_;
+		z[i] = (corners[i]->z*inverseW*0.5f)+0.5f;
+	}
+	if ((z[0] > 1.0f) && (z[1] > 1.0f) && (z[2] > 1.0f)) return;
+
+	//Either winding is drawn, turned anticlockwise so the inside of every edge is positive
+	float area = ((x[1]-x[0])*(y[2]-y[0]))-((x[2]-x[0])*(y[1]-y[0]));
+	if (area < 0.0f) {
+		float temp = x[1];
+		x[1] = x[2], x[2] = temp;
+		temp = y[1], y[1] = y[2], y[2] = temp;
+		temp = z[1], z[1] = z[2], z[2] = temp;
+		area = -area;
+	}
+	if (!(area > MIN_AREA)) return;
+
+	//Pixels whose centres are inside the triangle, clamped before converting so huge triangles cannot overflow
+	float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+	for (short i = 1; i < 3; i++) {
+		if (x[i] < minX) minX = x[i]; else if (x[i] > maxX) maxX = x[i];
+		if (y[i] < minY) minY = y[i]; else if (y[i] > maxY) maxY = y[i];
+	}
+	minX = ceil(minX-0.5f), maxX = floor(maxX-0.5f), minY = ceil(minY-0.5f), maxY = floor(maxY-0.5f);
+	if ((minX > maxX) || (minY > maxY) || (maxX < 0.0f) || (maxY < 0.0f) || (minX >= width_) || (minY >= height_))
+		return;
+
+	binnedTriangle triangle;
+	triangle.minX = (minX < 0.0f) ? 0 : int(minX);
+	triangle.minY = (minY < 0.0f) ? 0 : int(minY);
+	triangle.maxX = (maxX >= width_) ? width_-1 : int(maxX);
+	triangle.maxY = (maxY >= height_) ? height_-1 : int(maxY);
+	for (short i = 0; i < 3; i++) {
+		short j = (i+1)%3;
+		triangle.edges[i][0] = y[i]-y[j];
+		triangle.edges[i][1] = x[j]-x[i];
+		triangle.edges[i][2] = -((triangle.edges[i][0]*x[i])+(triangle.edges[i][1]*y[i]));
+	}
+	triangle.depth[0] = (((z[1]-z[0])*(y[2]-y[0]))-((z[2]-z[0])*(y[1]-y[0])))/area;
+	triangle.depth[1] = (((z[2]-z[0])*(x[1]-x[0]))-((z[1]-z[0])*(x[2]-x[0])))/area;
+	triangle.depth[2] = z[0]-(triangle.depth[0]*x[0])-(triangle.depth[1]*y[0]);
+
+	unsigned index = triangles.size();
+	triangles.push_back(triangle);
+	for (unsigned tileY = triangle.minY/OCCLUSION_TILE_HEIGHT; tileY <= triangle.maxY/OCCLUSION_TILE_HEIGHT; tileY++) {
+		for (unsigned tileX = triangle.minX/OCCLUSION_TILE_WIDTH; tileX <= triangle.maxX/OCCLUSION_TILE_WIDTH; tileX++)
+			bins[(tileY*tilesX)+tileX].push_back(index);
+	}
+}
+
+void OcclusionBuffer::rasteriseTile(unsigned tile) {
+	float * tileDepth = &depth_[tile*TILE_PIXELS];
+	for (unsigned i = 0; i < TILE_PIXELS; i++) tileDepth[i] = 1.0f;
+	int tileX = (tile%tilesX)*OCCLUSION_TILE_WIDTH, tileY = (tile/tilesX)*OCCLUSION_TILE_HEIGHT;
+
+	const vector<unsigned> & bin = bins[tile];
+	for (unsigned i = 0; i < bin.size(); i++) {
+		const binnedTriangle & triangle = triangles[bin[i]];
+		int startX = (triangle.minX > tileX) ? triangle.minX : tileX;
+		int endX = (triangle.maxX < tileX+int(OCCLUSION_TILE_WIDTH)) ? triangle.maxX : tileX+OCCLUSION_TILE_WIDTH-1;
+		int startY = (triangle.minY > tileY) ? triangle.minY : tileY;
+		int endY = (triangle.maxY < tileY+int(OCCLUSION_TILE_HEIGHT)) ? triangle.maxY : tileY+OCCLUSION_TILE_HEIGHT-1;
+		//Four pixels at a time from a multiple of four, which stays inside the tile as its width is a multiple of four
+		startX -= (startX-tileX)%4;
+
+		const float (*edges)[3] = triangle.edges;
+		for (int y = startY; y <= endY; y++) {
+			float centreY = y+0.5f;
+			float rowEdge0 = (edges[0][1]*centreY)+edges[0][2], rowEdge1 = (edges[1][1]*centreY)+edges[1][2],
+					rowEdge2 = (edges[2][1]*centreY)+edges[2][2];
+			float rowDepth = (triangle.depth[1]*centreY)+triangle.depth[2];
+			float * row = tileDepth+((y-tileY)*OCCLUSION_TILE_WIDTH)-tileX;
+#if defined(SM_SIMD_SSE)
+			__m128 edgeX0 = _mm_set1_ps(edges[0][0]), edgeX1 = _mm_set1_ps(edges[1][0]),
+					edgeX2 = _mm_set1_ps(edges[2][0]), depthX = _mm_set1_ps(triangle.depth[0]);
+			__m128 edgeRow0 = _mm_set1_ps(rowEdge0), edgeRow1 = _mm_set1_ps(rowEdge1), edgeRow2 = _mm_set1_ps(rowEdge2),
+					depthRow = _mm_set1_ps(rowDepth), zero = _mm_setzero_ps();
+			for (int x = startX; x <= endX; x += 4) {
+				__m128 centreX = _mm_add_ps(_mm_set1_ps(float(x)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+				__m128 inside = _mm_and_ps(_mm_and_ps(
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX0, centreX), edgeRow0), zero),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX1, centreX), edgeRow1), zero)),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX2, centreX), edgeRow2), zero));
+				__m128 depth = _mm_add_ps(_mm_mul_ps(depthX, centreX), depthRow), previous = _mm_loadu_ps(row+x);
+				_mm_storeu_ps(row+x, _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(previous, depth)),
+						_mm_andnot_ps(inside, previous)));
+			}
+#elif defined(SM_SIMD_NEON)
+			const float offsets[4] = {0.5f, 1.5f, 2.5f, 3.5f};
+			float32x4_t offset = vld1q_f32(offsets), zero = vdupq_n_f32(0.0f);
+			float32x4_t edgeRow0 = vdupq_n_f32(rowEdge0), edgeRow1 = vdupq_n_f32(rowEdge1),
+					edgeRow2 = vdupq_n_f32(rowEdge2), depthRow = vdupq_n_f32(rowDepth);
+			for (int x = startX; x <= endX; x += 4) {
+				float32x4_t centreX = vaddq_f32(vdupq_n_f32(float(x)), offset);
+				uint32x4_t inside = vandq_u32(vandq_u32(
+						vcgeq_f32(vmlaq_n_f32(edgeRow0, centreX, edges[0][0]), zero),
+						vcgeq_f32(vmlaq_n_f32(edgeRow1, centreX, edges[1][0]), zero)),
+						vcgeq_f32(vmlaq_n_f32(edgeRow2, centreX, edges[2][0]), zero));
+				float32x4_t depth = vmlaq_n_f32(depthRow, centreX, triangle.depth[0]), previous = vld1q_f32(row+x);
+				vst1q_f32(row+x, vbslq_f32(inside, vminq_f32(previous, depth), previous));
+			}
+#else
+			for (int x = startX; x <= endX; x += 4) {
+				for (short i = 0; i < 4; i++) {
+					float centreX = x+i+0.5f;
+					if (((edges[0][0]*centreX)+rowEdge0 >= 0.0f) && ((edges[1][0]*centreX)+rowEdge1 >= 0.0f)
+							&& ((edges[2][0]*centreX)+rowEdge2 >= 0.0f)) {
+						float depth = (triangle.depth[0]*centreX)+rowDepth;
+						if (depth < row[x+i]) row[x+i] = depth;
+					}
+				}
+			}
+#endif
+		}
+	}
+
+	float maxDepth = tileDepth[0];
+	for (unsigned i = 1; i < TILE_PIXELS; i++) if (tileDepth[i] > maxDepth) maxDepth = tileDepth[i];
+	tileMaxDepth[tile] = maxDepth;
+}
+
+//Tiles only touch their own pixels, so they could be split between threads
+void OcclusionBuffer::resolve() {
+	if (resolved) return;
+	SM_PROFILE_SCOPE("OcclusionBuffer::resolve");
+	for (unsigned i = 0; i < bins.size(); i++) rasteriseTile(i);
+	resolved = true;
+}
+
+void OcclusionBuffer::drawTriangles(const float * vertices, unsigned vertexCount, unsigned stride,
+		const unsigned * indices, unsigned indexCount, const mat4 & transformation) {
+	mat4 matrix = viewProjection*transformation;
+	clipVertices.resize(vertexCount);
+	for (unsigned i = 0; i < vertexCount; i++) {
+		const float * vertex = vertices+(i*stride);
+		float position[4] = {vertex[0], vertex[1], vertex[2], 1.0f};
+		multiplyMat4Vec4(matrix.component, position, &clipVertices[i].x);
+	}
+	for (unsigned i = 0; i+2 < indexCount; i += 3)
+		binTriangle(clipVertices[indices[i]], clipVertices[indices[i+1]], clipVertices[indices[i+2]]);
+	resolved = false;
+}
+
+void OcclusionBuffer::drawBox(const boundingBox & box, const mat4 & transformation) {
+	static const unsigned indices[36] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2,
+			6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+	float vertices[24];
+	for (short i = 0; i < 8; i++) {
+		vertices[i*3] = (i & 1) ? box.maximum.x : box.minimum.x;
+		vertices[(i*3)+1] = (i & 2) ? box.maximum.y : box.minimum.y;
+		vertices[(i*3)+2] = (i & 4) ? box.maximum.z : box.minimum.z;
+	}
+	drawTriangles(vertices, 8, 3, indices, 36, transformation);
+}
+
+void OcclusionBuffer::drawObject(Object & object) {
+	if ((!object.hasModel_) || (object.model_ == NULL)) return;
+	Model * model = object.model_;
+	if (model->occluderIndices_.empty()) return;
+	vec3 position, rotation, scale;
+	object.getInterpolatedState(&position, &rotation, &scale, NULL);
+	drawTriangles(&model->occluderVertices_[0], model->occluderVertices_.size()/3, 3, &model->occluderIndices_[0],
+			model->occluderIndices_.size(), getTransformationMatrix(position, rotation, scale));
+}
+
+bool OcclusionBuffer::boxVisible(const boundingBox & box, const mat4 & transformation) {
+	resolve();
+	mat4 matrix = viewProjection*transformation;
+	float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY, nearest = INFINITY;
+	for (short i = 0; i < 8; i++) {
+		float corner[4] = {(i & 1) ? box.maximum.x : box.minimum.x, (i & 2) ? box.maximum.y : box.minimum.y,
+				(i & 4) ? box.maximum.z : box.minimum.z, 1.0f}, clip[4];
+		multiplyMat4Vec4(matrix.component, corner, clip);
+		if (clip[3] <= NEAR_W) return true;
+		float inverseW = 1.0f/clip[3];
+		float x = ((clip[0]*inverseW*0.5f)+0.5f)*width_, y = ((clip[1]*inverseW*0.5f)+0.5f)*height_;
+		float depth = (clip[2]*inverseW*0.5f)+0.5f;
+		if (x < minX) minX = x;
+		if (x > maxX) maxX = x;
+		if (y < minY) minY = y;
+		if (y > maxY) maxY = y;
+		if (depth < nearest) nearest = depth;
+	}
+	if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= width_) || (minY >= height_) || (nearest > 1.0f)) return false;
+	nearest -= DEPTH_TOLERANCE;
+
+	//Every pixel the box touches, not just those whose centres it covers
+	int startX = (minX < 0.0f) ? 0 : int(minX), startY = (minY < 0.0f) ? 0 : int(minY);
+	int endX = (maxX >= width_) ? width_-1 : int(maxX), endY = (maxY >= height_) ? height_-1 : int(maxY);
+	for (int tileY = startY/OCCLUSION_TILE_HEIGHT; tileY <= int(endY/OCCLUSION_TILE_HEIGHT); tileY++) {
+		for (int tileX = startX/OCCLUSION_TILE_WIDTH; tileX <= int(endX/OCCLUSION_TILE_WIDTH); tileX++) {
+			unsigned tile = (tileY*tilesX)+tileX;
+			//Every pixel of the tile is in front of the box
+			if (tileMaxDepth[tile] < nearest) continue;
+
+			int tileLeft = tileX*OCCLUSION_TILE_WIDTH, tileTop = tileY*OCCLUSION_TILE_HEIGHT;
+			int left = (startX > tileLeft) ? startX : tileLeft;
+			int right = (endX < tileLeft+int(OCCLUSION_TILE_WIDTH)) ? endX : tileLeft+OCCLUSION_TILE_WIDTH-1;
+			int top = (startY > tileTop) ? startY : tileTop;
+			int bottom = (endY < tileTop+int(OCCLUSION_TILE_HEIGHT)) ? endY : tileTop+OCCLUSION_TILE_HEIGHT-1;
+			const float * tileDepth = &depth_[tile*TILE_PIXELS];
+			for (int y = top; y <= bottom; y++) {
+				const float * row = tileDepth+((y-tileTop)*OCCLUSION_TILE_WIDTH)-tileLeft;
+				for (int x = left; x <= right; x++) if (row[x] >= nearest) return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool OcclusionBuffer::objectVisible(Object & object) {
+	if ((!object.hasModel_) || (object.model_ == NULL)) return true;
+	vec3 position, rotation, scale;
+	object.getInterpolatedState(&position, &rotation, &scale, NULL);
+	return boxVisible(object.model_->bounds_, getTransformationMatrix(position, rotation, scale));
+}
+
+unsigned OcclusionBuffer::width() {
+	return width_;
+}
+
+unsigned OcclusionBuffer::height() {
+	return height_;
+}
+
+float OcclusionBuffer::depth(unsigned x, unsigned y) {
+	if ((x >= width_) || (y >= height_)) return 1.0f;
+	resolve();
+	unsigned tile = ((y/OCCLUSION_TILE_HEIGHT)*tilesX)+(x/OCCLUSION_TILE_WIDTH);
+	return depth_[(tile*TILE_PIXELS)+((y%OCCLUSION_TILE_HEIGHT)*OCCLUSION_TILE_WIDTH)+(x%OCCLUSION_TILE_WIDTH)];
+}
+
+unsigned OcclusionBuffer::triangleCount() {
+	return triangles.size();
+}
+
+}
@@ -11,11 +11,14 @@
 #include <vector>
 #include <fstream>
 #include <cstdarg>
+#include <cstring>
 using namespace std;
 
 #include <GL/glew.h>
 
 #include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/RenderQueue.h>
 #include <SuperMaximo_GameLibrary/classes/Shader.h>
 
 namespace SuperMaximo {
@@ -24,12 +27,34 @@ Shader::operator GLuint() const {
 	return program_;
 }
 
+void Shader::initUniforms() {
+	for (short i = 0; i < SHADER_LOCATION_ENUM_COUNT; i++) uniformLocation_[i] = -1;
+	for (short i = 0; i < SHADER_UNIFORM_BLOCK_ENUM_COUNT; i++) uniformBlockIndex_[i] = -1;
+	invalidateUniformCache();
+	resetUniformCacheCounters();
+}
+
+bool Shader::uniformChanged(shaderLocationEnum location, int type, const void * data, unsigned size) const {
+	//Nothing to upload for an empty array, such as the bones of a model without any
+	if ((uniformLocation_[location] == -1) || (size == 0)) return false;
+	uniformShadow & shadow = uniformShadow_[location];
+	if ((shadow.type == type) && (shadow.data.size() == size) && (memcmp(&shadow.data[0], data, size) == 0)) {
+		uniformCacheHits_++;
+		return false;
+	}
+	shadow.type = type;
+	shadow.data.assign((const char *)data, (const char *)data+size);
+	uniformCacheMisses_++;
+	currentRenderStats().uniformUploads++;
+	bindProgram(program_);
+	return true;
+}
+
 Shader::Shader(const string & name, const string & vertexShaderFile, const string & fragmentShaderFile, ...) :
 		name_(name) {
+	SM_PROFILE_SCOPE("Shader::Shader");
 	program_ = 0;
-	for (int i = 0; i <= EXTRA9_LOCATION; i++) {
-		uniformLocation_[i] = -1;
-	}
+	initUniforms();
 	string text = "";
 	ifstream file;
 	file.open(vertexShaderFile.c_str());
@@ -117,15 +142,16 @@ Shader::Shader(const string & name, const string & vertexShaderFile, const strin
 		char log[1024];
 		glGetProgramInfoLog(program_, 1024, NULL, log);
 		cout << log << endl;
-		glDeleteProgram(program_);
+		deleteProgram(program_);
 		return;
 	}
 }
 
 Shader::Shader(const string & name, const string & vertexShaderFile, const string & fragmentShaderFile,
 		const vector<int> & enums, const vector<char *> & attributeNames) : name_(name) {
+	SM_PROFILE_SCOPE("Shader::Shader");
 	program_ = 0;
-	for (short i = 0; i <= EXTRA9_LOCATION; i++) uniformLocation_[i] = -1;
+	initUniforms();
 	string text = "";
 	ifstream file;
 	file.open(vertexShaderFile.c_str());
@@ -205,15 +231,16 @@ Shader::Shader(const string & name, const string & vertexShaderFile, const strin
 		char log[1024];
 		glGetProgramInfoLog(program_, 1024, NULL, log);
 		cout << log << endl;
-		glDeleteProgram(program_);
+		deleteProgram(program_);
 		return;
 	}
 }
 
 Shader::Shader(const string & name, const string & vertexShaderFile, const string & fragmentShaderFile,
 		unsigned count, int * enums, const char ** attributeNames) : name_(name) {
+	SM_PROFILE_SCOPE("Shader::Shader");
 	program_ = 0;
-	for (short i = 0; i <= EXTRA9_LOCATION; i++) uniformLocation_[i] = -1;
+	initUniforms();
 	string text = "";
 	ifstream file;
 	file.open(vertexShaderFile.c_str());
@@ -293,13 +320,14 @@ Shader::Shader(const string & name, const string & vertexShaderFile, const strin
 		char log[1024];
 		glGetProgramInfoLog(program_, 1024, NULL, log);
 		cout << log << endl;
-		glDeleteProgram(program_);
+		deleteProgram(program_);
 		return;
 	}
 }
 
 Shader::~Shader() {
-	glDeleteProgram(program_);
+	flushRenderQueue();
+	deleteProgram(program_);
 }
 
 const string & Shader::name() const {
@@ -311,11 +339,12 @@ void Shader::bind() {
 }
 
 void Shader::use() const {
-	glUseProgram(program_);
+	bindProgram(program_);
 }
 
 GLint Shader::setUniformLocation(shaderLocationEnum dstLocation, const string & locationName) {
 	uniformLocation_[dstLocation] = glGetUniformLocation(program_, locationName.c_str());
+	uniformShadow_[dstLocation].type = 0;
 	return uniformLocation_[dstLocation];
 }
 
@@ -323,88 +352,168 @@ GLint Shader::uniformLocation(shaderLocationEnum location) const {
 	return uniformLocation_[location];
 }
 
+GLint Shader::setUniformBlock(shaderUniformBlockEnum dstBlock, const string & blockName) {
+	uniformBlockIndex_[dstBlock] = -1;
+	if (!uniformBufferObjectSupported()) return -1;
+	GLuint index = glGetUniformBlockIndex(program_, blockName.c_str());
+	if (index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program_, index, dstBlock);
+		uniformBlockIndex_[dstBlock] = index;
+	}
+	return uniformBlockIndex_[dstBlock];
+}
+
+GLint Shader::uniformBlockIndex(shaderUniformBlockEnum block) const {
+	return uniformBlockIndex_[block];
+}
+
 void Shader::setUniform1(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 1, data, sizeof(GLfloat)*count)) return;
 	glUniform1fv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform2(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 2, data, sizeof(GLfloat)*2*count)) return;
 	glUniform2fv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform3(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 3, data, sizeof(GLfloat)*3*count)) return;
 	glUniform3fv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform4(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 4, data, sizeof(GLfloat)*4*count)) return;
 	glUniform4fv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform9(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 9, data, sizeof(GLfloat)*9*count)) return;
 	glUniformMatrix3fv(uniformLocation_[location], count, GL_FALSE, data);
 }
 
 void Shader::setUniform16(shaderLocationEnum location, GLfloat * data, unsigned count) const {
+	if (!uniformChanged(location, 16, data, sizeof(GLfloat)*16*count)) return;
 	glUniformMatrix4fv(uniformLocation_[location], count, GL_FALSE, data);
 }
 
 void Shader::setUniform1(shaderLocationEnum location, int * data, unsigned count) const {
+	if (!uniformChanged(location, -1, data, sizeof(int)*count)) return;
 	glUniform1iv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform2(shaderLocationEnum location, int * data, unsigned count) const {
+	if (!uniformChanged(location, -2, data, sizeof(int)*2*count)) return;
 	glUniform2iv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform3(shaderLocationEnum location, int * data, unsigned count) const {
+	if (!uniformChanged(location, -3, data, sizeof(int)*3*count)) return;
 	glUniform3iv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform4(shaderLocationEnum location, int * data, unsigned count) const {
+	if (!uniformChanged(location, -4, data, sizeof(int)*4*count)) return;
 	glUniform4iv(uniformLocation_[location], count, data);
 }
 
 void Shader::setUniform1(shaderLocationEnum location, GLfloat data) const {
+	GLfloat values[1] = {data};
+	if (!uniformChanged(location, 1, values, sizeof(values))) return;
 	glUniform1f(uniformLocation_[location], data);
 }
 
 void Shader::setUniform2(shaderLocationEnum location, GLfloat data1, GLfloat data2) const {
+	GLfloat values[2] = {data1, data2};
+	if (!uniformChanged(location, 2, values, sizeof(values))) return;
 	glUniform2f(uniformLocation_[location], data1, data2);
 }
 
 void Shader::setUniform3(shaderLocationEnum location, GLfloat data1, GLfloat data2, GLfloat data3) const {
+	GLfloat values[3] = {data1, data2, data3};
+	if (!uniformChanged(location, 3, values, sizeof(values))) return;
 	glUniform3f(uniformLocation_[location], data1, data2, data3);
 }
 
 void Shader::setUniform4(shaderLocationEnum location, GLfloat data1, GLfloat data2, GLfloat data3, GLfloat data4) const {
+	GLfloat values[4] = {data1, data2, data3, data4};
+	if (!uniformChanged(location, 4, values, sizeof(values))) return;
 	glUniform4f(uniformLocation_[location], data1, data2, data3, data4);
 }
 
 void Shader::setUniform1(shaderLocationEnum location, int data) const {
+	int values[1] = {data};
+	if (!uniformChanged(location, -1, values, sizeof(values))) return;
 	glUniform1i(uniformLocation_[location], data);
 }
 
 void Shader::setUniform2(shaderLocationEnum location, int data1, int data2) const {
+	int values[2] = {data1, data2};
+	if (!uniformChanged(location, -2, values, sizeof(values))) return;
 	glUniform2i(uniformLocation_[location], data1, data2);
 }
 
 void Shader::setUniform3(shaderLocationEnum location, int data1, int data2, int data3) const {
+	int values[3] = {data1, data2, data3};
+	if (!uniformChanged(location, -3, values, sizeof(values))) return;
 	glUniform3i(uniformLocation_[location], data1, data2, data3);
 }
 
 void Shader::setUniform4(shaderLocationEnum location, int data1, int data2, int data3, int data4) const {
+	int values[4] = {data1, data2, data3, data4};
+	if (!uniformChanged(location, -4, values, sizeof(values))) return;
 	glUniform4i(uniformLocation_[location], data1, data2, data3, data4);
 }
 
 void Shader::setUniform2(shaderLocationEnum location, const vec2 & data) const {
+	GLfloat values[2] = {data.x, data.y};
+	if (!uniformChanged(location, 2, values, sizeof(values))) return;
 	glUniform2f(uniformLocation_[location], data.x, data.y);
 }
 
 void Shader::setUniform3(shaderLocationEnum location, const vec3 & data) const {
+	GLfloat values[3] = {data.x, data.y, data.z};
+	if (!uniformChanged(location, 3, values, sizeof(values))) return;
 	glUniform3f(uniformLocation_[location], data.x, data.y, data.z);
 }
 
 void Shader::setUniform4(shaderLocationEnum location, const vec4 & data) const {
+	GLfloat values[4] = {data.x, data.y, data.z, data.w};
+	if (!uniformChanged(location, 4, values, sizeof(values))) return;
 	glUniform4f(uniformLocation_[location], data.x, data.y, data.z, data.w);
 }
 
+void Shader::setProjectionUniform() const {
+	if (frameUniformsEnabled() && (uniformBlockIndex_[FRAME_UNIFORM_BLOCK] != -1)) updateFrameUniforms(); else {
+		mat4 projectionMatrix = getMatrix(PROJECTION_MATRIX);
+		setUniform16(PROJECTION_LOCATION, projectionMatrix);
+	}
+}
+
+void Shader::setBonePaletteUniforms(unsigned offset) const {
+	//Leave the active unit alone, as callers bind their own textures afterwards
+	textureUnitEnum previousTextureUnit = boundTextureUnit();
+	bindTextureUnit(BONE_TEXTURE_UNIT);
+	bindTexture(GL_TEXTURE_BUFFER, bonePaletteTexture());
+	bindTextureUnit(previousTextureUnit);
+	setUniform1(BONESAMPLER_LOCATION, int(BONE_TEXTURE_UNIT-TEXTURE0));
+	setUniform1(BONEOFFSET_LOCATION, int(offset));
+}
+
+void Shader::invalidateUniformCache() {
+	for (short i = 0; i < SHADER_LOCATION_ENUM_COUNT; i++) uniformShadow_[i].type = 0;
+}
+
+unsigned Shader::uniformCacheHits() const {
+	return uniformCacheHits_;
+}
+
+unsigned Shader::uniformCacheMisses() const {
+	return uniformCacheMisses_;
+}
+
+void Shader::resetUniformCacheCounters() {
+	uniformCacheHits_ = uniformCacheMisses_ = 0;
+}
+
 }
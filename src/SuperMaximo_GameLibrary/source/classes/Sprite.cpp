@@ -15,91 +15,105 @@ using namespace std;
 #include <SDL/SDL_image.h>
 
 #include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/RenderQueue.h>
 #include <SuperMaximo_GameLibrary/classes/Shader.h>
 #include <SuperMaximo_GameLibrary/classes/Object.h>
 #include <SuperMaximo_GameLibrary/classes/Sprite.h>
+#include <SuperMaximo_GameLibrary/classes/SpriteBatch.h>
 
 namespace SuperMaximo {
 
 Sprite::Sprite(const string & name, const string & fileName, int x, int y, int width,
-		int height, int newFrames, unsigned framerate, int originX, int originY) :
-		name_(name), frames(newFrames), framerate_(framerate), rect(x, y, width, height), originX_(originX),
-		originY_(originY) {
-
+		int height, int newFrames, unsigned framerate, int originX, int originY, TextureAtlas * atlas) :
+		name_(name), atlas_(atlas), ownsAtlas(false), frames(newFrames), framerate_(framerate),
+		rect(x, y, width, height), originX_(originX), originY_(originY) {
+	SM_PROFILE_SCOPE("Sprite::Sprite");
+
+	if (frames < 1) frames = 1;
+	atlasRect emptyRect = {0, 0, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f};
+	frameRects.resize(frames, emptyRect);
 	SDL_Surface * image = IMG_Load(fileName.c_str());
-	GLenum textureType;
-	if (textureRectangleEnabled()) textureType = GL_TEXTURE_RECTANGLE; else textureType = GL_TEXTURE_2D;
-
 	if (image == NULL) cout << "Could not load image " << fileName << endl; else {
-		SDL_SetAlpha(image, 0, 0);
-		GLenum textureFormat;
-		if (image->format->BytesPerPixel == 4) {
-			if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGBA; else textureFormat = GL_BGRA;
-		} else {
-			if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
-		}
 		if (rect.w < 1) rect.w = image->w;
 		if (rect.h < 1) rect.h = image->h;
-		SDL_Surface * tempSurface = SDL_CreateRGBSurface(SDL_HWSURFACE, rect.w, rect.h,
-				int(image->format->BitsPerPixel), image->format->Rmask, image->format->Gmask, image->format->Bmask,
-				image->format->Amask);
 
-		SDL_Rect tempRect;
-		tempRect.w = rect.w, tempRect.h = rect.h;
+		int numFrames = div(image->w, rect.w).quot;
+		if (atlas_ == NULL) {
+			//Lay the frames out in a roughly square grid, within the largest texture allowed
+			GLint maxSize = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+			unsigned columns = 1;
+			while (columns*columns < frames) columns++;
+			if ((maxSize > 0) && (columns*(rect.w+1) > unsigned(maxSize)+1)) columns = (maxSize+1)/(rect.w+1);
+			if (columns < 1) columns = 1;
+			unsigned rows = (frames+columns-1)/columns;
+			atlas_ = new TextureAtlas(name, (columns*(rect.w+1))-1, (rows*(rect.h+1))-1, 1);
+			ownsAtlas = true;
+		}
+
 		for (unsigned i = 0; i < frames; i++) {
-			texture_.push_back(0);
-			glGenTextures(1, &(texture_[i]));
 			int frame = i, row = 0;
-			int numFrames = div(image->w, rect.w).quot;
-			if (numFrames > 0) {
-				while (frame-(row*numFrames) >= numFrames) {
-					row++;
-					frame -= numFrames;
-				}
-			}
-			tempRect.x = rect.x+(frame*rect.w);
-			tempRect.y = rect.y+(row*rect.h);
-			SDL_BlitSurface(image, &tempRect, tempSurface, NULL);
-			glBindTexture(textureType, texture_[i]);
-			glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexImage2D(textureType, 0, tempSurface->format->BytesPerPixel, rect.w, rect.h, 0, textureFormat,
-					GL_UNSIGNED_BYTE, tempSurface->pixels);
+			if (numFrames > 0) row = frame/numFrames, frame -= row*numFrames;
+			atlas_->add(image, rect.x+(frame*rect.w), rect.y+(row*rect.h), rect.w, rect.h, &frameRects[i]);
 		}
-		SDL_FreeSurface(tempSurface);
+		SDL_FreeSurface(image);
 	}
 	boundShader_ = NULL;
 	if (vertexArrayObjectSupported()) {
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		bindVertexArray(vao);
 	}
 
-	GLfloat vertexArray[] = {
-		0.0f, rect.h, 0.0f, 1.0f,
-		0.0f, 0.0f, 0.0f, 1.0f,
-		rect.w, 0.0f, 0.0f, 1.0f,
-
-		0.0f, rect.h, 0.0f, 1.0f,
-		rect.w, rect.h, 0.0f, 1.0f,
-		rect.w, 0.0f, 0.0f, 1.0f
-	};
+	//Positions for every frame, followed by texture coordinates for every frame, so a frame is drawn by starting at
+	//its first vertex
+	vector<GLfloat> vertexArray(frames*6*6);
+	GLfloat * texCoords = &vertexArray[frames*6*4];
+	for (unsigned i = 0; i < frames; i++) {
+		const atlasRect & frameRect = frameRects[i];
+		GLfloat positions[] = {
+			0.0f, GLfloat(rect.h), 0.0f, 1.0f,
+			0.0f, 0.0f, 0.0f, 1.0f,
+			GLfloat(rect.w), 0.0f, 0.0f, 1.0f,
+
+			0.0f, GLfloat(rect.h), 0.0f, 1.0f,
+			GLfloat(rect.w), GLfloat(rect.h), 0.0f, 1.0f,
+			GLfloat(rect.w), 0.0f, 0.0f, 1.0f
+		};
+		GLfloat frameTexCoords[] = {
+			frameRect.s0, frameRect.t1,
+			frameRect.s0, frameRect.t0,
+			frameRect.s1, frameRect.t0,
+
+			frameRect.s0, frameRect.t1,
+			frameRect.s1, frameRect.t1,
+			frameRect.s1, frameRect.t0
+		};
+		for (unsigned j = 0; j < 24; j++) vertexArray[(i*24)+j] = positions[j];
+		for (unsigned j = 0; j < 12; j++) texCoords[(i*12)+j] = frameTexCoords[j];
+	}
 
 	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexArray), vertexArray, GL_STATIC_DRAW);
+	bindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexArray.size()*sizeof(GLfloat), &vertexArray[0], GL_STATIC_DRAW);
+	currentRenderStats().bytesUploaded += vertexArray.size()*sizeof(GLfloat);
 	glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(frames*6*4*sizeof(GLfloat)));
 	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	if (vertexArrayObjectSupported()) glBindVertexArray(0);
+	if (vertexArrayObjectSupported()) bindVertexArray(0);
 	for (char i = 0; i < 16; i++) glDisableVertexAttribArray(i);
-	glBindTexture(textureType, 0);
 }
 
 Sprite::~Sprite() {
-	for (unsigned i = 0; i < frames; i++) glDeleteTextures(1, &(texture_[i]));
-	glDeleteBuffers(1, &vbo);
-	if (vertexArrayObjectSupported()) glDeleteVertexArrays(1, &vao);
+	//Queued and batched draws may still use this sprite's texture and buffers
+	flushRenderQueue();
+	flushSpriteBatches();
+	if (ownsAtlas) delete atlas_;
+	deleteBuffer(vbo);
+	if (vertexArrayObjectSupported()) deleteVertexArray(vao);
 }
 
 const string & Sprite::name() {
@@ -119,8 +133,9 @@ unsigned Sprite::framerate() {
 	return framerate_;
 }
 
-void Sprite::draw(int x, int y, float depth, float rotation, float xScale, float yScale, float alpha,
+void Sprite::draw(float x, float y, float depth, float rotation, float xScale, float yScale, float alpha,
 		unsigned frame, Shader * shaderOverride) {
+	SM_PROFILE_SCOPE("Sprite::draw");
 	Shader * shaderToUse;
 	if (shaderOverride != NULL) shaderToUse = shaderOverride;
 	else if (boundShader_ != NULL) shaderToUse = boundShader_;
@@ -128,40 +143,51 @@ void Sprite::draw(int x, int y, float depth, float rotation, float xScale, float
 
 	if (shaderToUse != NULL) {
 		if (frame >= frames) frame = frames-1;
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(textureRectangleEnabled() ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D, texture_[frame]);
+		GLenum target = textureTarget();
 
 		pushMatrix();
-			translateMatrix(x-originX_, y-originY_, depth);
-			translateMatrix(originX_, originY_, 0.0f);
-			rotateMatrix(rotation, 0.0f, 0.0f, 1.0f);
-			scaleMatrix(xScale, yScale, 0.0f);
+			transformMatrix(vec3(x, y, depth), vec3(0.0f, 0.0f, rotation), vec3(xScale, yScale, 0.0f));
 			translateMatrix(-originX_, -originY_, 0.0f);
 
+			if (renderQueueEnabled()) {
+				renderCommand command(shaderToUse, target, texture(), vertexArrayObjectSupported() ? vao : 0, vbo, 6);
+				command.firstVertex = frame*6;
+				command.texCoordOffset = frames*6*4*sizeof(GLfloat);
+				queueRenderCommand(command);
+				popMatrix();
+				return;
+			}
+
+			bindTextureUnit(TEXTURE0);
+			bindTexture(target, texture());
 			shaderToUse->use();
 			shaderToUse->setUniform16(MODELVIEW_LOCATION, getMatrix(MODELVIEW_MATRIX));
-			shaderToUse->setUniform16(PROJECTION_LOCATION, getMatrix(PROJECTION_MATRIX));
+			shaderToUse->setProjectionUniform();
 			shaderToUse->setUniform1(TEXSAMPLER_LOCATION, 0);
 
-			if (vertexArrayObjectSupported()) {
-				glBindVertexArray(vao);
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
-			} else {
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			//Bindings are left in place for the next draw, which is often another sprite using the same ones
+			if (vertexArrayObjectSupported()) bindVertexArray(vao); else {
+				bindBuffer(GL_ARRAY_BUFFER, vbo);
 				glVertexAttribPointer(VERTEX_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, 0);
+				glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0,
+						(GLvoid*)(frames*6*4*sizeof(GLfloat)));
 				glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
+				glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
 			}
 
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			if (vertexArrayObjectSupported()) glBindVertexArray(0);
+			glDrawArrays(GL_TRIANGLES, frame*6, 6);
+			currentRenderStats().drawCalls++;
+			currentRenderStats().triangles += 2;
 		popMatrix();
 	}
 }
 
 void Sprite::draw(Object & object) {
-	draw(object.x_, object.y_, object.z_, object.zRotation_, object.xScale_, object.yScale_, object.alpha_,
-			object.frame_.front(), object.boundShader_);
+	vec3 position, rotation, scale;
+	float alpha;
+	object.getInterpolatedState(&position, &rotation, &scale, &alpha);
+	draw(position.x, position.y, position.z, rotation.z, scale.x, scale.y, alpha, object.frame_.front(),
+			object.boundShader_);
 }
 
 int Sprite::width() {
@@ -180,9 +206,26 @@ int Sprite::originY() {
 	return originY_;
 }
 
-GLuint Sprite::texture(unsigned frame) {
+TextureAtlas * Sprite::atlas() {
+	return atlas_;
+}
+
+GLuint Sprite::texture() {
+	return atlas_ != NULL ? atlas_->texture() : 0;
+}
+
+GLuint Sprite::texture(unsigned) {
+	return texture();
+}
+
+GLenum Sprite::textureTarget() {
+	if (atlas_ != NULL) return atlas_->target();
+	return textureRectangleEnabled() ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D;
+}
+
+const atlasRect & Sprite::frameRect(unsigned frame) {
 	if (frame >= frames) frame = frames-1;
-	return texture_[frame];
+	return frameRects[frame];
 }
 
 void Sprite::bindShader(Shader * shader) {
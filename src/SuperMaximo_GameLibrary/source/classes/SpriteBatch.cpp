@@ -0,0 +1,191 @@
+//============================================================================
+// Name        : SpriteBatch.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary SpriteBatch class for drawing many sprites at once
+//============================================================================
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+using namespace std;
+
+#include <GL/glew.h>
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Utils.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/classes/Shader.h>
+#include <SuperMaximo_GameLibrary/classes/Object.h>
+#include <SuperMaximo_GameLibrary/classes/Sprite.h>
+#include <SuperMaximo_GameLibrary/classes/SpriteBatch.h>
+#include <SuperMaximo_GameLibrary/classes/StreamBuffer.h>
+
+namespace SuperMaximo {
+
+static vector<SpriteBatch*> spriteBatches;
+
+SpriteBatch::SpriteBatch(unsigned capacity, Shader * shader) : capacity_(capacity), vao(0), texture_(0),
+		textureTarget(GL_TEXTURE_2D), shader_(NULL), boundShader_(shader) {
+	if (capacity_ < 1) capacity_ = 1;
+	if (capacity_ > SPRITE_BATCH_MAX_CAPACITY) capacity_ = SPRITE_BATCH_MAX_CAPACITY;
+	vertices.reserve(capacity_*4);
+
+	//Every quad uses the same indices, so they are only uploaded once
+	vector<GLushort> indices(capacity_*6);
+	for (unsigned i = 0; i < capacity_; i++) {
+		GLushort first = i*4;
+		indices[i*6] = first+3, indices[(i*6)+1] = first, indices[(i*6)+2] = first+1;
+		indices[(i*6)+3] = first+3, indices[(i*6)+4] = first+2, indices[(i*6)+5] = first+1;
+	}
+
+	if (vertexArrayObjectSupported()) {
+		glGenVertexArrays(1, &vao);
+		bindVertexArray(vao);
+	}
+	glGenBuffers(1, &ibo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+	currentRenderStats().bytesUploaded += indices.size()*sizeof(GLushort);
+
+	//Each flush points the attributes at where its vertices were written, so they are not set up here
+	if (vertexArrayObjectSupported()) bindVertexArray(0); else bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	streamBuffer = new StreamBuffer(capacity_*4*sizeof(spriteVertex));
+	bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	spriteBatches.push_back(this);
+}
+
+SpriteBatch::~SpriteBatch() {
+	flush();
+	for (unsigned i = 0; i < spriteBatches.size(); i++) {
+		if (spriteBatches[i] == this) {
+			spriteBatches.erase(spriteBatches.begin()+i);
+			break;
+		}
+	}
+	delete streamBuffer;
+	deleteBuffer(ibo);
+	if (vertexArrayObjectSupported()) deleteVertexArray(vao);
+}
+
+void SpriteBatch::setAttributePointers(long offset) {
+	glVertexAttribPointer(VERTEX_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(spriteVertex), (GLvoid*)(offset));
+	glVertexAttribPointer(TEXTURE0_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(spriteVertex),
+			(GLvoid*)(offset+(3*sizeof(GLfloat))));
+	glVertexAttribPointer(COLOR0_ATTRIBUTE, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(spriteVertex),
+			(GLvoid*)(offset+(5*sizeof(GLfloat))));
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE);
+	glEnableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+	glEnableVertexAttribArray(COLOR0_ATTRIBUTE);
+}
+
+void SpriteBatch::draw(Sprite * sprite, float x, float y, float depth, float rotation, float xScale, float yScale,
+		float alpha, unsigned frame, Shader * shaderOverride) {
+	Shader * shaderToUse;
+	if (shaderOverride != NULL) shaderToUse = shaderOverride;
+	else if (boundShader_ != NULL) shaderToUse = boundShader_;
+	else shaderToUse = SuperMaximo::boundShader();
+	if ((shaderToUse == NULL) || (sprite == NULL)) return;
+
+	//Frames, and sprites sharing an atlas, share a texture and so a batch
+	GLuint texture = sprite->texture();
+	GLenum target = sprite->textureTarget();
+	mat4 currentModelview = getMatrix(MODELVIEW_MATRIX);
+	if (!vertices.empty()) {
+		if ((texture != texture_) || (target != textureTarget) || (shaderToUse != shader_) ||
+				(vertices.size() >= capacity_*4) ||
+				(memcmp(currentModelview.component, modelview.component, sizeof(modelview.component)) != 0)) {
+			flush();
+		}
+	}
+	if (vertices.empty()) {
+		texture_ = texture, textureTarget = target, shader_ = shaderToUse;
+		modelview = currentModelview;
+	}
+
+	//The same transformation as Sprite::draw, applied to the four corners
+	float sine, cosine;
+	sinCos(rotation, &sine, &cosine);
+	float width = sprite->width(), height = sprite->height();
+	float left = -sprite->originX(), top = -sprite->originY(), right = left+width, bottom = top+height;
+	const atlasRect & frameRect = sprite->frameRect(frame);
+	float cornerX[4] = {left, right, right, left}, cornerY[4] = {top, top, bottom, bottom};
+	float cornerS[4] = {frameRect.s0, frameRect.s1, frameRect.s1, frameRect.s0};
+	float cornerT[4] = {frameRect.t0, frameRect.t0, frameRect.t1, frameRect.t1};
+
+	if (alpha < 0.0f) alpha = 0.0f; else if (alpha > 1.0f) alpha = 1.0f;
+	GLubyte alphaByte = GLubyte((alpha*255.0f)+0.5f);
+	for (unsigned i = 0; i < 4; i++) {
+		float scaledX = cornerX[i]*xScale, scaledY = cornerY[i]*yScale;
+		spriteVertex vertex;
+		vertex.x = (cosine*scaledX)-(sine*scaledY)+x;
+		vertex.y = (sine*scaledX)+(cosine*scaledY)+y;
+		vertex.z = depth;
+		vertex.s = cornerS[i], vertex.t = cornerT[i];
+		vertex.color[0] = vertex.color[1] = vertex.color[2] = 255, vertex.color[3] = alphaByte;
+		vertices.push_back(vertex);
+	}
+}
+
+void SpriteBatch::draw(Object & object) {
+	if (object.sprite_ == NULL) return;
+	vec3 position, rotation, scale;
+	float alpha;
+	object.getInterpolatedState(&position, &rotation, &scale, &alpha);
+	draw(object.sprite_, position.x, position.y, position.z, rotation.z, scale.x, scale.y, alpha,
+			object.frame_.front());
+}
+
+void SpriteBatch::flush() {
+	if (vertices.empty()) return;
+	SM_PROFILE_GPU_SCOPE("SpriteBatch::flush");
+	unsigned quadCount = vertices.size()/4;
+	long offset = streamBuffer->write(&vertices[0], vertices.size()*sizeof(spriteVertex), sizeof(spriteVertex));
+
+	shader_->use();
+	shader_->setUniform16(MODELVIEW_LOCATION, modelview);
+	shader_->setProjectionUniform();
+	shader_->setUniform1(TEXSAMPLER_LOCATION, 0);
+	bindTextureUnit(TEXTURE0);
+	bindTexture(textureTarget, texture_);
+
+	if (vertexArrayObjectSupported()) bindVertexArray(vao); else bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	bindBuffer(GL_ARRAY_BUFFER, streamBuffer->buffer());
+	setAttributePointers(offset);
+
+	glDrawElements(GL_TRIANGLES, quadCount*6, GL_UNSIGNED_SHORT, 0);
+	currentRenderStats().drawCalls++;
+	currentRenderStats().triangles += quadCount*2;
+
+	//Other draws without vertex array objects only set up the vertex attribute
+	if (!vertexArrayObjectSupported()) {
+		glDisableVertexAttribArray(TEXTURE0_ATTRIBUTE);
+		glDisableVertexAttribArray(COLOR0_ATTRIBUTE);
+	}
+	vertices.clear();
+}
+
+unsigned SpriteBatch::size() {
+	return vertices.size()/4;
+}
+
+unsigned SpriteBatch::capacity() {
+	return capacity_;
+}
+
+void SpriteBatch::bindShader(Shader * shader) {
+	boundShader_ = shader;
+}
+
+Shader * SpriteBatch::boundShader() {
+	return boundShader_;
+}
+
+void flushSpriteBatches() {
+	for (unsigned i = 0; i < spriteBatches.size(); i++) spriteBatches[i]->flush();
+}
+
+}
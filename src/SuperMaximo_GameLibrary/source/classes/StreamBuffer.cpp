@@ -0,0 +1,136 @@
+//============================================================================
+// Name        : StreamBuffer.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary StreamBuffer class for geometry rewritten every frame
+//============================================================================
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+using namespace std;
+
+#include <GL/glew.h>
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/RenderQueue.h>
+#include <SuperMaximo_GameLibrary/classes/StreamBuffer.h>
+
+namespace SuperMaximo {
+
+static vector<StreamBuffer*> streamBuffers;
+
+StreamBuffer::StreamBuffer(unsigned regionSize, GLenum target) : target_(target), buffer_(0),
+		regionSize_(regionSize), region(0), offset(0), mapping(NULL) {
+	for (unsigned i = 0; i < STREAM_BUFFER_FRAMES; i++) fences[i] = NULL;
+	GLsizeiptr size = GLsizeiptr(regionSize_)*STREAM_BUFFER_FRAMES;
+	glGenBuffers(1, &buffer_);
+	bindBuffer(target_, buffer_);
+	if (bufferStorageSupported()) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target_, size, NULL, flags);
+		mapping = static_cast<unsigned char *>(glMapBufferRange(target_, 0, size, flags));
+		if (mapping == NULL) {
+			//Storage cannot be changed once it is set, so start again with a new buffer
+			cout << "Could not map stream buffer, it will be written with glBufferSubData" << endl;
+			deleteBuffer(buffer_);
+			glGenBuffers(1, &buffer_);
+			bindBuffer(target_, buffer_);
+		}
+	}
+	if (mapping == NULL) glBufferData(target_, size, NULL, GL_STREAM_DRAW);
+	streamBuffers.push_back(this);
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (unsigned i = 0; i < streamBuffers.size(); i++) {
+		if (streamBuffers[i] == this) {
+			streamBuffers.erase(streamBuffers.begin()+i);
+			break;
+		}
+	}
+	for (unsigned i = 0; i < STREAM_BUFFER_FRAMES; i++) if (fences[i] != NULL) glDeleteSync(fences[i]);
+	if (mapping != NULL) {
+		bindBuffer(target_, buffer_);
+		glUnmapBuffer(target_);
+	}
+	deleteBuffer(buffer_);
+}
+
+void StreamBuffer::nextRegion() {
+	if (mapping != NULL) {
+		if (fences[region] != NULL) glDeleteSync(fences[region]);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	region = (region+1)%STREAM_BUFFER_FRAMES, offset = 0;
+
+	if (mapping != NULL) {
+		if (fences[region] == NULL) return;
+		//The fence is normally long signalled, unless the GPU has fallen more than a couple of frames behind
+		if (glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+			SM_PROFILE_SCOPE("StreamBuffer::wait");
+			while (glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = NULL;
+	} else if (region == 0) {
+		//Draws still reading the old storage keep it until they finish
+		bindBuffer(target_, buffer_);
+		glBufferData(target_, GLsizeiptr(regionSize_)*STREAM_BUFFER_FRAMES, NULL, GL_STREAM_DRAW);
+	}
+}
+
+long StreamBuffer::write(const void * data, unsigned size, unsigned alignment) {
+	if (alignment == 0) alignment = 1;
+	unsigned regionStart = region*regionSize_, start = regionStart+offset;
+	start += (alignment-(start%alignment))%alignment;
+	if (start+size > regionStart+regionSize_) {
+		if (size <= regionSize_) {
+			//Queued draws may still read this region, so they have to reach GL before it is fenced or orphaned
+			flushRenderQueue();
+			nextRegion();
+			regionStart = region*regionSize_, start = regionStart;
+			start += (alignment-(start%alignment))%alignment;
+		}
+		if (start+size > regionStart+regionSize_) {
+			cout << "Cannot write " << size << " bytes to a stream buffer with " << regionSize_ << " byte regions"
+					<< endl;
+			return -1;
+		}
+	}
+
+	bindBuffer(target_, buffer_);
+	if (mapping != NULL) memcpy(mapping+start, data, size); else glBufferSubData(target_, start, size, data);
+	offset = (start+size)-regionStart;
+	currentRenderStats().bytesUploaded += size;
+	return start;
+}
+
+void StreamBuffer::endFrame() {
+	if (offset > 0) nextRegion();
+}
+
+GLuint StreamBuffer::buffer() {
+	return buffer_;
+}
+
+GLenum StreamBuffer::target() {
+	return target_;
+}
+
+unsigned StreamBuffer::regionSize() {
+	return regionSize_;
+}
+
+bool StreamBuffer::persistentlyMapped() {
+	return mapping != NULL;
+}
+
+void endStreamBufferFrames() {
+	for (unsigned i = 0; i < streamBuffers.size(); i++) streamBuffers[i]->endFrame();
+}
+
+}
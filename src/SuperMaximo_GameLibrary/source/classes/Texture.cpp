@@ -15,6 +15,7 @@ using namespace std;
 #include <SDL/SDL_image.h>
 
 #include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
 #include <SuperMaximo_GameLibrary/classes/Texture.h>
 using namespace SuperMaximo;
 
@@ -56,10 +57,11 @@ Texture::Texture(const string & name, textureTypeEnum textureType, unsigned numL
 }
 
 Texture::~Texture() {
-	glDeleteTextures(1, &texture);
+	deleteTexture(texture);
 }
 
 void Texture::reload(textureTypeEnum textureType, const string & fileName, ...) {
+	SM_PROFILE_SCOPE("Texture::reload");
 	type_ = textureType;
 	if (textureType == TEXTURE_3D) cout << "Cannot create a 3D texture with the arguments given" << endl; else {
 		SDL_Surface * image = IMG_Load(fileName.c_str());
@@ -73,17 +75,19 @@ void Texture::reload(textureTypeEnum textureType, const string & fileName, ...)
 				if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
 			}
 			glGenTextures(1, &texture);
-			glBindTexture(textureType, texture);
+			bindTexture(textureType, texture);
 			glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 			if (textureType != TEXTURE_CUBE) {
 				glTexImage2D(textureType, 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			} else {
 				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, image->format->BytesPerPixel, image->w, image->h, 0,
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 
 				GLenum sides[5] = {GL_TEXTURE_CUBE_MAP_NEGATIVE_X, GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
@@ -96,28 +100,30 @@ void Texture::reload(textureTypeEnum textureType, const string & fileName, ...)
 					if (image == NULL) cout << "Could not load image " << file << endl; else {
 						glTexImage2D(sides[i], 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 								GL_UNSIGNED_BYTE, image->pixels);
+						currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 						SDL_FreeSurface(image);
 					}
 				}
 				va_end(files);
 			}
-			glBindTexture(textureType, 0);
+			bindTexture(textureType, 0);
 		}
 	}
 }
 
 void Texture::reload(textureTypeEnum textureType, unsigned numLayers, ...) {
+	SM_PROFILE_SCOPE("Texture::reload");
 	type_ = textureType;
 	if (textureType == TEXTURE_3D) {
 		glGenTextures(1, &texture);
 		if (texture2dArrayDisabled()) {
 			textureType = TEXTURE_2D;
 			type_ = TEXTURE_2D;
-			glBindTexture(GL_TEXTURE_2D, texture);
+			bindTexture(GL_TEXTURE_2D, texture);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		} else {
-			glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+			bindTexture(GL_TEXTURE_2D_ARRAY, texture);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
@@ -148,26 +154,28 @@ void Texture::reload(textureTypeEnum textureType, unsigned numLayers, ...) {
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
 				else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, image->w, image->h, 1, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			}
 		}
 		va_end(files);
-		glBindTexture(textureType, 0);
+		bindTexture(textureType, 0);
 	} else cout << "Wrong type of texture specified" << endl;
 }
 
 void Texture::reload(textureTypeEnum textureType, const vector<string> & fileNames) {
+	SM_PROFILE_SCOPE("Texture::reload");
 	type_ = textureType;
 	if (textureType == TEXTURE_3D) {
 		glGenTextures(1, &texture);
 		if (texture2dArrayDisabled()) {
 			textureType = TEXTURE_2D;
 			type_ = TEXTURE_2D;
-			glBindTexture(GL_TEXTURE_2D, texture);
+			bindTexture(GL_TEXTURE_2D, texture);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		} else {
-			glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+			bindTexture(GL_TEXTURE_2D_ARRAY, texture);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
@@ -195,10 +203,11 @@ void Texture::reload(textureTypeEnum textureType, const vector<string> & fileNam
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
 				else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, image->w, image->h, 1, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			}
 		}
-		glBindTexture(textureType, 0);
+		bindTexture(textureType, 0);
 	} else {
 		SDL_Surface * image = IMG_Load(fileNames[0].c_str());
 		if (image == NULL) cout << "Could not load image " << fileNames[0] << endl; else {
@@ -211,17 +220,19 @@ void Texture::reload(textureTypeEnum textureType, const vector<string> & fileNam
 				if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
 			}
 			glGenTextures(1, &texture);
-			glBindTexture(textureType, texture);
+			bindTexture(textureType, texture);
 			glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 			if (textureType != TEXTURE_CUBE) {
 				glTexImage2D(textureType, 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			} else {
 				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, image->format->BytesPerPixel, image->w, image->h, 0,
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 
 				GLenum sides[5] = {GL_TEXTURE_CUBE_MAP_NEGATIVE_X, GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
@@ -231,27 +242,29 @@ void Texture::reload(textureTypeEnum textureType, const vector<string> & fileNam
 					if (image == NULL) cout << "Could not load image " << fileNames[i+1] << endl; else {
 						glTexImage2D(sides[i], 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 								GL_UNSIGNED_BYTE, image->pixels);
+						currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 						SDL_FreeSurface(image);
 					}
 				}
 			}
-			glBindTexture(textureType, 0);
+			bindTexture(textureType, 0);
 		}
 	}
 }
 
 void Texture::reload(textureTypeEnum textureType, unsigned numLayers, string * fileNames) {
+	SM_PROFILE_SCOPE("Texture::reload");
 	type_ = textureType;
 	if (textureType == TEXTURE_3D) {
 		glGenTextures(1, &texture);
 		if (texture2dArrayDisabled()) {
 			textureType = TEXTURE_2D;
 			type_ = TEXTURE_2D;
-			glBindTexture(GL_TEXTURE_2D, texture);
+			bindTexture(GL_TEXTURE_2D, texture);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		} else {
-			glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+			bindTexture(GL_TEXTURE_2D_ARRAY, texture);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
@@ -279,10 +292,11 @@ void Texture::reload(textureTypeEnum textureType, unsigned numLayers, string * f
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
 				else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, image->w, image->h, 1, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			}
 		}
-		glBindTexture(textureType, 0);
+		bindTexture(textureType, 0);
 	} else {
 		SDL_Surface * image = IMG_Load(fileNames[0].c_str());
 		if (image == NULL) cout << "Could not load image " << fileNames[0] << endl; else {
@@ -295,17 +309,19 @@ void Texture::reload(textureTypeEnum textureType, unsigned numLayers, string * f
 				if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
 			}
 			glGenTextures(1, &texture);
-			glBindTexture(textureType, texture);
+			bindTexture(textureType, texture);
 			glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 			if (textureType != TEXTURE_CUBE) {
 				glTexImage2D(textureType, 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 						GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 			} else {
 				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, image->format->BytesPerPixel, image->w, image->h, 0,
 						textureFormat, GL_UNSIGNED_BYTE, image->pixels);
+				currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 				SDL_FreeSurface(image);
 
 				GLenum sides[5] = {GL_TEXTURE_CUBE_MAP_NEGATIVE_X, GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
@@ -315,11 +331,12 @@ void Texture::reload(textureTypeEnum textureType, unsigned numLayers, string * f
 					if (image == NULL) cout << "Could not load image " << fileNames[i+1] << endl; else {
 						glTexImage2D(sides[i], 0, image->format->BytesPerPixel, image->w, image->h, 0, textureFormat,
 								GL_UNSIGNED_BYTE, image->pixels);
+						currentRenderStats().bytesUploaded += image->w*image->h*image->format->BytesPerPixel;
 						SDL_FreeSurface(image);
 					}
 				}
 			}
-			glBindTexture(textureType, 0);
+			bindTexture(textureType, 0);
 		}
 	}
 }
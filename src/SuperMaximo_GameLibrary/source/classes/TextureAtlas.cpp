@@ -0,0 +1,195 @@
+//============================================================================
+// Name        : TextureAtlas.cpp
+// Author      : Max Foster
+// Created on  : 17 Oct 2026
+// Version     : 1.0
+// Copyright   : http://creativecommons.org/licenses/by/3.0/
+// Description : SuperMaximo GameLibrary TextureAtlas class for packing images into one texture
+//============================================================================
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include <GL/glew.h>
+#include <SDL/SDL_video.h>
+
+#include <SuperMaximo_GameLibrary/Display.h>
+#include <SuperMaximo_GameLibrary/Profiler.h>
+#include <SuperMaximo_GameLibrary/classes/TextureAtlas.h>
+
+namespace SuperMaximo {
+
+TextureAtlas::operator GLuint() const {
+	return texture_;
+}
+
+TextureAtlas::TextureAtlas(const string & name, int width, int height, int padding) : name_(name),
+		width_(width), height_(height), padding_(padding) {
+	if (width_ < 1) width_ = 1;
+	if (height_ < 1) height_ = 1;
+	if (padding_ < 0) padding_ = 0;
+	target_ = textureRectangleEnabled() ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D;
+
+	glGenTextures(1, &texture_);
+	bindTexture(target_, texture_);
+	glTexParameteri(target_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(target_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	//Start transparent, so padding and any unfilled parts of an area never show garbage
+	vector<GLubyte> pixels(width_*height_*4, 0);
+	glTexImage2D(target_, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	currentRenderStats().bytesUploaded += pixels.size();
+	clear();
+}
+
+TextureAtlas::~TextureAtlas() {
+	deleteTexture(texture_);
+}
+
+const string & TextureAtlas::name() {
+	return name_;
+}
+
+//Returns the height the bottom of a width by height area would rest at if its left edge was at the start of the
+//given skyline node, or -1 if it does not fit there
+int TextureAtlas::fit(unsigned index, int width, int height) {
+	//The packing area is extended by the padding, which only needs to go between areas, not at the edges
+	if (skyline[index].x+width > width_+padding_) return -1;
+	int y = skyline[index].y, widthLeft = width;
+	for (unsigned i = index; widthLeft > 0; i++) {
+		if (skyline[i].y > y) y = skyline[i].y;
+		if (y+height > height_+padding_) return -1;
+		widthLeft -= skyline[i].width;
+	}
+	return y;
+}
+
+bool TextureAtlas::pack(unsigned width, unsigned height, atlasRect * rect) {
+	int paddedWidth = width+padding_, paddedHeight = height+padding_;
+	int bestIndex = -1, bestY = 0, bestBottom = 0, bestWidth = 0;
+	for (unsigned i = 0; i < skyline.size(); i++) {
+		int y = fit(i, paddedWidth, paddedHeight);
+		if (y < 0) continue;
+		int bottom = y+paddedHeight;
+		if ((bestIndex < 0) || (bottom < bestBottom) || ((bottom == bestBottom) && (skyline[i].width < bestWidth))) {
+			bestIndex = i, bestY = y, bestBottom = bottom, bestWidth = skyline[i].width;
+		}
+	}
+	if (bestIndex < 0) return false;
+
+	skylineNode node = {skyline[bestIndex].x, bestBottom, paddedWidth};
+	skyline.insert(skyline.begin()+bestIndex, node);
+	//Trim or remove the nodes now underneath the new one
+	for (unsigned i = bestIndex+1; i < skyline.size(); i++) {
+		int overlap = (node.x+node.width)-skyline[i].x;
+		if (overlap <= 0) break;
+		if (overlap < skyline[i].width) {
+			skyline[i].x += overlap;
+			skyline[i].width -= overlap;
+			break;
+		}
+		skyline.erase(skyline.begin()+i);
+		i--;
+	}
+	for (unsigned i = 0; i+1 < skyline.size(); i++) {
+		if (skyline[i].y == skyline[i+1].y) {
+			skyline[i].width += skyline[i+1].width;
+			skyline.erase(skyline.begin()+i+1);
+			i--;
+		}
+	}
+	usedArea += (unsigned long long)(paddedWidth)*paddedHeight;
+
+	rect->x = node.x, rect->y = bestY, rect->w = width, rect->h = height;
+	float sScale = 1.0f, tScale = 1.0f;
+	if (target_ != GL_TEXTURE_RECTANGLE) sScale = 1.0f/width_, tScale = 1.0f/height_;
+	rect->s0 = rect->x*sScale, rect->t0 = rect->y*tScale;
+	rect->s1 = (rect->x+int(width))*sScale, rect->t1 = (rect->y+int(height))*tScale;
+	return true;
+}
+
+bool TextureAtlas::add(SDL_Surface * image, int x, int y, unsigned width, unsigned height, atlasRect * rect) {
+	SM_PROFILE_SCOPE("TextureAtlas::add");
+	if (!pack(width, height, rect)) {
+		cout << "Texture atlas " << name_ << " has no room for a " << width << "x" << height << " image" << endl;
+		return false;
+	}
+	if (image == NULL) return true;
+
+	//Only the part of the area that overlaps the image is uploaded
+	int left = x < 0 ? 0 : x, top = y < 0 ? 0 : y;
+	int right = x+int(width), bottom = y+int(height);
+	if (right > image->w) right = image->w;
+	if (bottom > image->h) bottom = image->h;
+	if ((right <= left) || (bottom <= top)) return true;
+
+	GLenum textureFormat;
+	int bytesPerPixel = image->format->BytesPerPixel;
+	if (bytesPerPixel == 4) {
+		if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGBA; else textureFormat = GL_BGRA;
+	} else {
+		if (image->format->Rmask == 0x000000ff) textureFormat = GL_RGB; else textureFormat = GL_BGR;
+	}
+
+	//Read the sub-rectangle straight out of the surface rather than blitting it to a temporary one first. SDL pads
+	//rows to 4 bytes, so rows that are not a whole number of pixels are described with the alignment instead
+	if (image->pitch % bytesPerPixel == 0) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, image->pitch/bytesPerPixel);
+	} else {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, image->w);
+	}
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, left);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, top);
+	bindTexture(target_, texture_);
+	glTexSubImage2D(target_, 0, rect->x+(left-x), rect->y+(top-y), right-left, bottom-top, textureFormat,
+			GL_UNSIGNED_BYTE, image->pixels);
+	currentRenderStats().bytesUploaded += (right-left)*(bottom-top)*bytesPerPixel;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	return true;
+}
+
+bool TextureAtlas::add(SDL_Surface * image, atlasRect * rect) {
+	if (image == NULL) return false;
+	return add(image, 0, 0, image->w, image->h, rect);
+}
+
+void TextureAtlas::clear() {
+	skyline.clear();
+	skylineNode node = {0, 0, width_+padding_};
+	skyline.push_back(node);
+	usedArea = 0;
+}
+
+GLuint TextureAtlas::texture() {
+	return texture_;
+}
+
+GLenum TextureAtlas::target() {
+	return target_;
+}
+
+int TextureAtlas::width() {
+	return width_;
+}
+
+int TextureAtlas::height() {
+	return height_;
+}
+
+int TextureAtlas::padding() {
+	return padding_;
+}
+
+float TextureAtlas::occupancy() {
+	return float(usedArea)/(float(width_+padding_)*float(height_+padding_));
+}
+
+}